@@ -0,0 +1,90 @@
+#include <string.h>
+#include <vector>
+#include <png.h>
+#include "Assets.hpp"
+#include "BlockTextureMap.hpp"
+
+using std::string;
+
+////////////////////////////////////////////////////////////////////////////////
+static string digitName(int digit) {
+  return string("digit") + std::to_string(digit) + ".png";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Load a PNG file into the atlas and return its ID, or WHITE if it can't
+static AtlasId loadTexture(TextureAtlas & atlas, const string & dir, const string & name, bool & ok) {
+  string file = dir.empty() ? name : dir + "/" + name;
+
+  png_image image;
+  memset(&image, 0, sizeof(image));
+  image.version = PNG_IMAGE_VERSION;
+
+  if(!png_image_begin_read_from_file(&image, file.c_str())) {
+    printf("Error loading texture %s: %s\n", file.c_str(), image.message);
+    ok = false;
+    return TextureAtlas::WHITE;
+  }
+
+  // Decoded to RGBA whatever the file has
+  image.format = PNG_FORMAT_RGBA;
+  std::vector<uint8_t> pixels(PNG_IMAGE_SIZE(image));
+
+  if(!png_image_finish_read(&image, NULL, pixels.data(), 0, NULL)) {
+    printf("Error loading texture %s: %s\n", file.c_str(), image.message);
+    ok = false;
+    return TextureAtlas::WHITE;
+  }
+
+  return atlas.add(pixels.data(), image.width, image.height, PNG_IMAGE_ROW_STRIDE(image), name);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool loadAssetImages(TextureAtlas & atlas, Assets & assets, const string & dir) {
+  bool ok = true;
+
+  assets.background     = loadTexture(atlas, dir, "background.png", ok);
+  block_textures.bg     = loadTexture(atlas, dir, "block_bg.png", ok);
+  block_textures.outer  = loadTexture(atlas, dir, "block_outer.png", ok);
+  block_textures.inner  = loadTexture(atlas, dir, "block_inner.png", ok);
+  block_textures.top    = loadTexture(atlas, dir, "block_top.png", ok);
+  block_textures.bottom = loadTexture(atlas, dir, "block_bottom.png", ok);
+  block_textures.left   = loadTexture(atlas, dir, "block_left.png", ok);
+  block_textures.right  = loadTexture(atlas, dir, "block_right.png", ok);
+  assets.paused         = loadTexture(atlas, dir, "paused.png", ok);
+  assets.game_over      = loadTexture(atlas, dir, "game_over.png", ok);
+
+  for(int i = 0; i <= 9; i++) {
+    assets.digits[i] = loadTexture(atlas, dir, digitName(i), ok);
+  }
+
+  // Every block drawn as one quad
+  BlockTextureMap::buildSprites(atlas);
+  return ok;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool findTexture(const TextureAtlas & atlas, const string & name, AtlasId & id) {
+  id = atlas.find(name);
+  return id != TextureAtlas::NOT_FOUND;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool findAssets(const TextureAtlas & atlas, Assets & assets) {
+  bool ok = findTexture(atlas, "background.png", assets.background) &&
+            findTexture(atlas, "block_bg.png", block_textures.bg) &&
+            findTexture(atlas, "block_outer.png", block_textures.outer) &&
+            findTexture(atlas, "block_inner.png", block_textures.inner) &&
+            findTexture(atlas, "block_top.png", block_textures.top) &&
+            findTexture(atlas, "block_bottom.png", block_textures.bottom) &&
+            findTexture(atlas, "block_left.png", block_textures.left) &&
+            findTexture(atlas, "block_right.png", block_textures.right) &&
+            findTexture(atlas, "paused.png", assets.paused) &&
+            findTexture(atlas, "game_over.png", assets.game_over);
+
+  for(int i = 0; ok && i <= 9; i++) {
+    ok = findTexture(atlas, digitName(i), assets.digits[i]);
+  }
+
+  return ok && BlockTextureMap::findSprites(atlas);
+}
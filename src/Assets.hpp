@@ -0,0 +1,35 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the images the display draws and the two ways to get them
+/// into a TextureAtlas: decoding the PNG files in the textures directory and
+/// composing the block sprites, or mapping the bundle bbt_pack made from them
+/// at build time, which is ready to draw as it is.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <string>
+#include "TextureAtlas.hpp"
+
+// Bundle bbt_pack writes next to the executable, which is tried first
+#define BBT_ASSET_BUNDLE "textures.bbta"
+
+// Everything the display draws apart from the blocks, which go in
+// block_textures and the block sprites
+struct Assets {
+  AtlasId background;
+  AtlasId paused;
+  AtlasId game_over;
+  AtlasId digits[10];
+};
+
+// Decode the PNG files in dir into the atlas, named after their files, and
+// compose the block sprites. An image that fails to load is printed and left
+// white, and false is returned.
+bool loadAssetImages(TextureAtlas & atlas, Assets & assets, const std::string & dir);
+
+// Look up every image by name in an atlas mapped from a bundle. Returns
+// false if any is missing, e.g. the bundle is from another version.
+bool findAssets(const TextureAtlas & atlas, Assets & assets);
+
+#endif
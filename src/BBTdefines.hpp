@@ -5,14 +5,27 @@
 #ifndef BBT_DEFINES
 #define BBT_DEFINES 1
 
-#include <array>
-
 // instead of passing queue structure into contructors, have the objects create
 // the queue based on this name 
 #define BBT_EVENT_QUEUE_NAME "/BBT_EVENT_INPUT_QUEUE"
 #define BBT_EVENT_MSG_SIZE 4
 #define BBT_EVENT_QUEUE_SIZE 32
 
+// Period of the game tick, which the display also draws at
+#define BBT_TICK_PERIOD_NS 16666666
+
+// The BeagleBone LCD cape in portrait, and how big a board cell is on it
+#define BBT_SCREEN_WIDTH 272
+#define BBT_SCREEN_HEIGHT 480
+#define BBT_BLOCK_PIXELS 20
+
+// In process ring from the input threads to the controller, see EventRing
+#define BBT_EVENT_RING_SIZE 64
+
+// GameDelta records the controller can get ahead of the display by. Changes
+// are merged into the next record while the ring is full, so nothing is lost.
+#define BBT_DELTA_RING_SIZE 16
+
 #ifdef NOXENOMAI
 #define rt_printf printf
 #else
@@ -37,7 +50,7 @@ public:
   int id;    // Unique identifier for this particular block piece
   int color; // Color of block (1 .. 7)
   
-  BlockData() { BlockData(0, 0); };
+  BlockData() : id(0), color(0) {};
   BlockData(int _id, int _color) : id(_id), color(_color) {};
 
   bool operator==(const BlockData & bd) const {
@@ -51,6 +64,5 @@ public:
 
 const int BOARD_WIDTH = 10;
 const int BOARD_HEIGHT = 20;
-typedef std::array<std::array<BlockData, BOARD_HEIGHT>, BOARD_WIDTH> BoardState;
 
 #endif //BBT_DEFINES
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <cstring>
+#include <vector>
+#include "BlockTextureMap.hpp"
+
+BlockTextures block_textures;
+
+// Colors to use for blocks
+static const std::vector<unsigned int> colors = {0x000000, 0xFF6666, 0x66FF66,
+  0x6666FF, 0xFFFF66, 0x66FFFF, 0xFF66FF, 0x0099FF };
+
+// Texture maps for every combination of neighbour bits in a BlockShape
+static BlockTextureMap shape_table[SHAPE_NEIGHBOURS + 1];
+
+// Composed block for every combination of neighbour bits, 0 until built
+static AtlasId sprite_table[SHAPE_NEIGHBOURS + 1];
+
+////////////////////////////////////////////////////////////////////////////////
+BlockTextureMap::BlockTextureMap() {
+  color = 0;
+  sprite = 0;
+  memset(tex, 0, sizeof(tex));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Generate texture map from board state
+BlockTextureMap::BlockTextureMap(unsigned int block_x, unsigned int block_y, const BoardState & board) {
+  bool context[3][3];
+
+  for(auto x = 0; x < 3; x++) {
+    for(auto y = 0; y < 3; y++) {
+      int pos_x = block_x + x - 1;
+      int pos_y = block_y + y - 1;
+      context[x][y] = pos_x >= 0 && pos_x < BOARD_WIDTH &&
+                      pos_y >= 0 && pos_y < BOARD_HEIGHT &&
+                      board.get(block_x, block_y) == board.get(pos_x, pos_y);
+    }
+  }
+
+  initialize(context, board.get(block_x, block_y).color);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Generate texture map based on individual tetromino
+BlockTextureMap::BlockTextureMap(unsigned int block_x, unsigned int block_y, const Tetromino & piece) {
+  bool context[3][3];
+
+  for(auto x = 0; x < 3; x++) {
+    for(auto y = 0; y < 3; y++) {
+      int pos_x = block_x + x - 1;
+      int pos_y = block_y + y - 1;
+      context[x][y] = pos_x >= 0 && pos_x < piece.width &&
+                      pos_y >= 0 && pos_y < piece.height &&
+                      piece.getBlock(pos_x, pos_y).color != 0;
+    }
+  }
+
+  initialize(context, piece.getBlock(block_x, block_y).color);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Texture map from a shape, with no neighbour compares or branches. The color
+// index is three bits, so it is always in the table.
+BlockTextureMap::BlockTextureMap(BlockShape shape) {
+  *this = shape_table[shape & SHAPE_NEIGHBOURS];
+  color = colors[shape >> SHAPE_COLOR_SHIFT];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BlockTextureMap::buildShapeTable() {
+  for(int neighbours = 0; neighbours <= SHAPE_NEIGHBOURS; neighbours++) {
+    bool context[3][3] = {
+      {(neighbours & SHAPE_DOWN_LEFT) != 0,  (neighbours & SHAPE_LEFT) != 0,  (neighbours & SHAPE_UP_LEFT) != 0},
+      {(neighbours & SHAPE_DOWN) != 0,       true,                            (neighbours & SHAPE_UP) != 0},
+      {(neighbours & SHAPE_DOWN_RIGHT) != 0, (neighbours & SHAPE_RIGHT) != 0, (neighbours & SHAPE_UP_RIGHT) != 0}};
+
+    shape_table[neighbours].initialize(context, 0);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sprite pixel (x, y) is pixel (x, y) of the part covering it, scaled if the
+// part image is another size, just as the nine parts draw it at full size
+static AtlasId composeSprite(TextureAtlas & atlas, const BlockTextureMap & map, const std::string & name) {
+  int width = atlas.getImageWidth(block_textures.bg);
+  int height = atlas.getImageHeight(block_textures.bg);
+  std::vector<uint8_t> pixels(width * height * 4);
+
+  for(int y = 0; y < height; y++) {
+    // Parts are indexed from the bottom, rows from the top
+    int j = 4 * y < height ? 2 : 4 * y < 3 * height ? 1 : 0;
+
+    for(int x = 0; x < width; x++) {
+      int i = 4 * x < width ? 0 : 4 * x < 3 * width ? 1 : 2;
+
+      AtlasId part = map.tex[i][j];
+      int part_width = atlas.getImageWidth(part), part_height = atlas.getImageHeight(part);
+      int part_x = x * part_width / width, part_y = y * part_height / height;
+      memcpy(&pixels[(y * width + x) * 4],
+             atlas.getImage(part) + (part_y * part_width + part_x) * 4, 4);
+    }
+  }
+
+  return atlas.add(pixels.data(), width, height, width * 4, name);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Sprites are named after the first combination of neighbour bits that has
+// them, which is the one they were composed for
+static std::string spriteName(int neighbours) {
+  char name[16];
+  snprintf(name, sizeof(name), "sprite_%02x", neighbours);
+  return name;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static int firstWithSameParts(int neighbours) {
+  for(int other = 0; other < neighbours; other++) {
+    if(shape_table[other] == shape_table[neighbours]) return other;
+  }
+  return neighbours;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Many neighbour combinations end up with the same parts, e.g. a corner
+// neighbour only matters next to both edge neighbours, so there are far fewer
+// sprites than combinations
+void BlockTextureMap::buildSprites(TextureAtlas & atlas) {
+  memset(sprite_table, 0, sizeof(sprite_table));
+  buildShapeTable();
+
+  for(int neighbours = 0; neighbours <= SHAPE_NEIGHBOURS; neighbours++) {
+    int first = firstWithSameParts(neighbours);
+    sprite_table[neighbours] = first < neighbours ? sprite_table[first] :
+      composeSprite(atlas, shape_table[neighbours], spriteName(neighbours));
+  }
+
+  buildShapeTable();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool BlockTextureMap::findSprites(const TextureAtlas & atlas) {
+  memset(sprite_table, 0, sizeof(sprite_table));
+  buildShapeTable();
+
+  AtlasId found[SHAPE_NEIGHBOURS + 1];
+  for(int neighbours = 0; neighbours <= SHAPE_NEIGHBOURS; neighbours++) {
+    found[neighbours] = atlas.find(spriteName(firstWithSameParts(neighbours)));
+    if(found[neighbours] == TextureAtlas::NOT_FOUND) return false;
+  }
+
+  memcpy(sprite_table, found, sizeof(sprite_table));
+  buildShapeTable();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// From context of surrounding blocks, determine which textures to use to
+// draw this block -- this consists of four corners, four edges, and the
+// center, which is always the same.
+void BlockTextureMap::initialize(bool ctx[3][3], unsigned int block_color) {
+  color = colors.at(block_color);
+  sprite = sprite_table[(ctx[0][0] ? SHAPE_DOWN_LEFT : 0) | (ctx[1][0] ? SHAPE_DOWN : 0) |
+                        (ctx[2][0] ? SHAPE_DOWN_RIGHT : 0) | (ctx[0][1] ? SHAPE_LEFT : 0) |
+                        (ctx[2][1] ? SHAPE_RIGHT : 0) | (ctx[0][2] ? SHAPE_UP_LEFT : 0) |
+                        (ctx[1][2] ? SHAPE_UP : 0) | (ctx[2][2] ? SHAPE_UP_RIGHT : 0)];
+
+  tex[0][0] = ctx[1][0] && ctx[0][1] && ctx[0][0] ? block_textures.bg :
+              ctx[1][0] && ctx[0][1]              ? block_textures.inner :
+              ctx[1][0]                           ? block_textures.left :
+              ctx[0][1]                           ? block_textures.bottom :
+                                                    block_textures.outer;
+  tex[0][1] = ctx[0][1] ? block_textures.bg : block_textures.left;
+  tex[0][2] = ctx[1][2] && ctx[0][1] && ctx[0][2] ? block_textures.bg :
+              ctx[1][2] && ctx[0][1]              ? block_textures.inner :
+              ctx[1][2]                           ? block_textures.left :
+              ctx[0][1]                           ? block_textures.top :
+                                                    block_textures.outer;
+  tex[1][0] = ctx[1][0] ? block_textures.bg : block_textures.bottom;
+  tex[1][1] = block_textures.bg;
+  tex[1][2] = ctx[1][2] ? block_textures.bg : block_textures.top;
+  tex[2][0] = ctx[1][0] && ctx[2][1] && ctx[2][0] ? block_textures.bg :
+              ctx[1][0] && ctx[2][1]              ? block_textures.inner :
+              ctx[1][0]                           ? block_textures.right :
+              ctx[2][1]                           ? block_textures.bottom :
+                                                    block_textures.outer;
+  tex[2][1] = ctx[2][1] ? block_textures.bg : block_textures.right;
+  tex[2][2] = ctx[1][2] && ctx[2][1] && ctx[2][2] ? block_textures.bg :
+              ctx[1][2] && ctx[2][1]              ? block_textures.inner :
+              ctx[1][2]                           ? block_textures.right :
+              ctx[2][1]                           ? block_textures.top :
+                                                    block_textures.outer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool BlockTextureMap::operator==(const BlockTextureMap & other) const {
+  return memcmp(tex, other.tex, sizeof(tex)) == 0 && color == other.color;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool BlockTextureMap::operator!=(const BlockTextureMap & other) const {
+  return !operator==(other);
+}
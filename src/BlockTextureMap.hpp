@@ -0,0 +1,57 @@
+#ifndef BLOCK_TEXTURE_MAP_H
+#define BLOCK_TEXTURE_MAP_H
+
+#include <array>
+#include "BBTdefines.hpp"
+#include "BoardState.hpp"
+#include "ShapeMap.hpp"
+#include "Tetromino.hpp"
+#include "TextureAtlas.hpp"
+
+// Images that make up a block, loaded into the atlas by the display
+struct BlockTextures {
+  AtlasId bg, outer, inner;
+  AtlasId top, bottom, left, right;
+};
+
+extern BlockTextures block_textures;
+
+// 3x3 table of which textures to use to draw this block -- this consists of
+// four corners, four edges, and the center, which is always the same. Once
+// the sprites are built, sprite is the whole block composed from them.
+struct BlockTextureMap {
+  AtlasId tex[3][3];
+  AtlasId sprite;     // 0 if there is none
+  unsigned int color;
+
+  BlockTextureMap();
+
+  // Generate texture map from board state
+  BlockTextureMap(unsigned int block_x, unsigned int block_y, const BoardState & board);
+
+  // Generate texture map based on individual tetromino
+  BlockTextureMap(unsigned int block_x, unsigned int block_y, const Tetromino & piece);
+
+  // Look up the texture map for a shape from the ShapeMap. The table has to
+  // be built once the block textures are known.
+  explicit BlockTextureMap(BlockShape shape);
+  static void buildShapeTable();
+
+  // Compose every distinct block from its nine parts into one image in the
+  // atlas, so it draws as a single quad, and build the shape table with
+  // them. Call after the block textures were added, before packing.
+  static void buildSprites(TextureAtlas & atlas);
+
+  // Build the shape table with the sprites buildSprites made, from an atlas
+  // mapped from a bundle. Returns false if any is missing.
+  static bool findSprites(const TextureAtlas & atlas);
+
+  void initialize(bool ctx[3][3], unsigned int block_color);
+
+  bool operator==(const BlockTextureMap & other) const;
+  bool operator!=(const BlockTextureMap & other) const;
+};
+
+typedef std::array<std::array<BlockTextureMap, BOARD_HEIGHT>, BOARD_WIDTH> BoardTextureMap;
+
+#endif
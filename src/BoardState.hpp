@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the BoardState class: the block grid plus an occupancy
+/// bitboard kept in sync with it. The grid is stored row-major so that whole
+/// rows move as single blocks when lines are cleared. Every cell that changes
+/// is also marked dirty until clearDirty, so readers can pick up only what
+/// changed.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BOARD_STATE_H
+#define BOARD_STATE_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include "BBTdefines.hpp"
+
+// One bit per column, bit x set if the block at column x is occupied
+typedef uint16_t RowMask;
+const RowMask FULL_ROW_MASK = (1 << BOARD_WIDTH) - 1;
+
+// One bit per row, bit y set if row y is included
+typedef uint32_t RowSet;
+const RowSet ALL_ROWS = (1u << BOARD_HEIGHT) - 1;
+
+class BoardState {
+public:
+  BoardState() { clear(); }
+
+  const BlockData & get(int x, int y) const {
+    return cells[y][x];
+  }
+
+  // All writes go through here so that the row masks stay in sync
+  void set(int x, int y, const BlockData & bd) {
+    if(cells[y][x] == bd) return;
+    cells[y][x] = bd;
+    dirty[y] |= (RowMask)(1 << x);
+
+    if(bd.color != 0) {
+      rows[y] |= (RowMask)(1 << x);
+    } else {
+      rows[y] &= (RowMask)~(1 << x);
+    }
+  }
+
+  RowMask getRow(int y) const {
+    return rows[y];
+  }
+
+  bool isRowFull(int y) const {
+    return rows[y] == FULL_ROW_MASK;
+  }
+
+  // Columns of row y changed since the last clearDirty
+  RowMask getDirty(int y) const {
+    return dirty[y];
+  }
+
+  void clearDirty() {
+    dirty.fill(0);
+  }
+
+  void copyRow(int to, int from) {
+    cells[to] = cells[from];
+    rows[to] = rows[from];
+    dirty[to] = FULL_ROW_MASK;
+  }
+
+  void clearRow(int y) {
+    cells[y].fill(BlockData(0, 0));
+    rows[y] = 0;
+    dirty[y] = FULL_ROW_MASK;
+  }
+
+  // Store the index of every completely filled row of candidates in
+  // full_rows, lowest first. Returns the number of rows found.
+  int findFullRows(int * full_rows, RowSet candidates = ALL_ROWS) const {
+    int n_rows = 0;
+    for(int y = 0; y < BOARD_HEIGHT; y++) {
+      if(((candidates >> y) & 1) && isRowFull(y)) full_rows[n_rows++] = y;
+    }
+    return n_rows;
+  }
+
+  // Remove the given rows (sorted lowest first) and drop the rows above them.
+  // Each run of rows between two removed rows moves down as one block.
+  void removeRows(const int * removed, int n_removed) {
+    if(n_removed == 0) return;
+
+    // Everything from the lowest removed row up to the old top row changes
+    int top = BOARD_HEIGHT - 1;
+    while(top > removed[0] && rows[top] == 0) top--;
+    std::fill(dirty.begin() + removed[0], dirty.begin() + top + 1, FULL_ROW_MASK);
+
+    int to = removed[0];
+    for(int i = 0; i < n_removed; i++) {
+      int from = removed[i] + 1;
+      int end = i + 1 < n_removed ? removed[i + 1] : BOARD_HEIGHT;
+
+      std::copy(cells.begin() + from, cells.begin() + end, cells.begin() + to);
+      std::copy(rows.begin() + from, rows.begin() + end, rows.begin() + to);
+      to += end - from;
+    }
+
+    for(; to <= top; to++) {
+      clearRow(to);
+    }
+  }
+
+  void clear() {
+    for(int y = 0; y < BOARD_HEIGHT; y++) {
+      clearRow(y);
+    }
+  }
+
+private:
+  std::array<std::array<BlockData, BOARD_WIDTH>, BOARD_HEIGHT> cells;
+  std::array<RowMask, BOARD_HEIGHT> rows;
+  std::array<RowMask, BOARD_HEIGHT> dirty;
+};
+
+#endif
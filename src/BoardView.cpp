@@ -0,0 +1,105 @@
+#include <cstddef>
+#include "BoardView.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+BoardView::BoardView() : tick(0), seq(0) {
+  redrawAll();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Copy a complete state, as after a resync
+void BoardView::reset(const GameState & state) {
+  tick = state.tick;
+  seq = state.seq;
+  board = state.board;
+  shown = state.board;
+  active = state.active;
+  active.place(shown);
+
+  status.next = state.next;
+  status.score = state.score;
+  status.level = state.level;
+  status.paused = state.paused;
+  status.game_over = state.game_over;
+
+  redrawAll();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Apply the changed cells and the new active piece pose
+/// \returns False if the delta was not applied
+bool BoardView::apply(const GameDelta & delta) {
+  if(delta.resync || delta.seq <= seq) return false;
+
+  // Only lift the piece off the board if something can have changed under it
+  bool update_active = delta.n_changes != 0 || !active.samePose(delta.active);
+
+  if(update_active) liftActive();
+
+  for(unsigned int i = 0; i < delta.n_changes; i++) {
+    const CellChange & change = delta.changes[i];
+    board.set(change.x, change.y, change.block);
+    show(change.x, change.y, change.block);
+  }
+
+  if(update_active) {
+    active = delta.active;
+    dropActive();
+  }
+
+  tick = delta.tick;
+  seq = delta.seq;
+  status = delta.status;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Mark a cell and its neighbours for redraw
+void BoardView::touch(int x, int y) {
+  RowMask columns = (RowMask)((7 << x) >> 1) & FULL_ROW_MASK;
+
+  for(int row = y - 1; row <= y + 1; row++) {
+    if(row >= 0 && row < BOARD_HEIGHT) redraw[row] |= columns;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Change a shown cell, marking it for redraw if it differs
+void BoardView::show(int x, int y, const BlockData & block) {
+  if(shown.get(x, y) == block) return;
+
+  shown.set(x, y, block);
+  touch(x, y);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Show the settled blocks under the active piece again
+void BoardView::liftActive() {
+  const Tetromino::Cell * cells = active.getCells();
+  if(cells == NULL) return;
+
+  for(int i = 0; i < Tetromino::num_cells; i++) {
+    int x = active.pos_x + cells[i].x;
+    int y = active.pos_y + cells[i].y;
+    if(x < 0 || x >= BOARD_WIDTH || y < 0 || y >= BOARD_HEIGHT) continue;
+
+    show(x, y, board.get(x, y));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Show the active piece on top of the settled blocks
+void BoardView::dropActive() {
+  const Tetromino::Cell * cells = active.getCells();
+  if(cells == NULL) return;
+
+  BlockData block = active.getBlock(cells[0].x, cells[0].y);
+
+  for(int i = 0; i < Tetromino::num_cells; i++) {
+    int x = active.pos_x + cells[i].x;
+    int y = active.pos_y + cells[i].y;
+    if(x < 0 || x >= BOARD_WIDTH || y < 0 || y >= BOARD_HEIGHT) continue;
+
+    show(x, y, block);
+  }
+}
@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the BoardView class: the board as the display draws it, the
+/// settled blocks with the active piece on top, kept up to date from
+/// GameDelta records. It tracks which cells may look different since the
+/// last clearRedraw, including the neighbours of every changed cell since a
+/// block's outline depends on them.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BOARD_VIEW_H
+#define BOARD_VIEW_H
+
+#include <array>
+#include <cstdint>
+#include "BBTdefines.hpp"
+#include "BoardState.hpp"
+#include "GameDelta.hpp"
+#include "GameState.hpp"
+#include "Tetromino.hpp"
+
+class BoardView {
+public:
+  BoardView();
+
+  // Start over from a complete state. Every cell needs a redraw.
+  void reset(const GameState & state);
+
+  // Bring the view up to delta.seq. Deltas that are not newer than the view
+  // are ignored, as are resync deltas, which need reset instead. Several
+  // deltas can carry the same tick, e.g. input applied between ticks.
+  // Returns true if the delta was applied.
+  bool apply(const GameDelta & delta);
+
+  uint32_t getTick() const { return tick; }
+  uint32_t getSeq() const { return seq; }
+  const BoardState & getShown() const { return shown; }
+  const GameStatus & getStatus() const { return status; }
+
+  // Cells of row y that may need to be redrawn
+  RowMask getRedraw(int y) const { return redraw[y]; }
+  const std::array<RowMask, BOARD_HEIGHT> & getRedrawRows() const { return redraw; }
+  void redrawAll() { redraw.fill(FULL_ROW_MASK); }
+  void clearRedraw() { redraw.fill(0); }
+
+private:
+  void touch(int x, int y);
+  void show(int x, int y, const BlockData & block);
+  void liftActive();
+  void dropActive();
+
+  uint32_t tick;
+  uint32_t seq;
+  BoardState board;   // settled blocks only
+  BoardState shown;   // board plus the active piece
+  Tetromino active;
+  GameStatus status;
+  std::array<RowMask, BOARD_HEIGHT> redraw;
+};
+
+#endif
@@ -1,402 +1,302 @@
-#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include <cstdlib>
 #include <vector>
-#include <string>
 #include <tuple>
-#include <GL/gl.h>
-#include <GL/glx.h>
-#include <GL/glu.h>
-#include <SDL/SDL.h>
-#include <SDL/SDL_image.h>
+#include "Assets.hpp"
 #include "BBTdefines.hpp"
 #include "GameController.hpp"
 #include "GameState.hpp"
+#include "BlockTextureMap.hpp"
+#include "BoardView.hpp"
+#include "FrameStats.hpp"
+#include "LatencyStats.hpp"
+#include "RenderBackend.hpp"
+#include "ShapeMap.hpp"
+#include "StatCounters.hpp"
+
+const float BOARD_INSET = (AREA_WIDTH - BOARD_WIDTH) / 2.0f;
+
+// Wake up this long after the controller's next tick is due, so it has
+// published by then
+const uint64_t WAKE_SLACK_NS = 1000000;
+
+// Longest sleep waiting for a tickless controller, so window events and
+// signals are still seen while the game is idle
+const int IDLE_WAKE_MS = 100;
+
+// Overlay rows from the top: fetch, shapes, submit and flush in us, then
+// blocks redrawn, quads and driver calls, each in its own color
+const int OVERLAY_ROWS = 7;
+const unsigned int overlay_colors[OVERLAY_ROWS] = {
+  0xFF8080, 0xFFFF80, 0x80FF80, 0x80C0FF, 0xFFFFFF, 0xFFC0FF, 0xC0C0C0};
+
+// Everything the display draws, packed into one texture
+static TextureAtlas atlas;
+static Assets assets;
 
-using std::string;
-
-const GLdouble SCREEN_WIDTH  = 272.0;
-const GLdouble SCREEN_HEIGHT = 480.0;
-const GLdouble BLOCK_SIZE    = 20.0;
-const GLdouble AREA_WIDTH    = SCREEN_WIDTH / BLOCK_SIZE;
-const GLdouble AREA_HEIGHT   = SCREEN_HEIGHT / BLOCK_SIZE;
-const GLdouble BOARD_INSET   = (AREA_WIDTH - BOARD_WIDTH) / 2.0;
-
-// Textures to load
-static std::vector<GLuint> digit_textures;
-static GLuint tex_bg;
-static GLuint tex_block_bg, tex_block_outer, tex_block_inner;
-static GLuint tex_block_top, tex_block_bottom, tex_block_left, tex_block_right;
-static GLuint tex_paused;
-static GLuint tex_game_over;
-
-// Colors to use for blocks
-static std::vector<unsigned int> colors = {0x000000, 0xFF6666, 0x66FF66,
-  0x6666FF, 0xFFFF66, 0x66FFFF, 0xFF66FF, 0x0099FF };
-
-// 3x3 table of which textures to use to draw this block -- this consists of
-// four corners, four edges, and the center, which is always the same.
-struct BlockTextureMap {
-  GLuint tex[3][3];
-  unsigned int color;
-
-  BlockTextureMap() {
-    color = 0;
-    memset(tex, 0, sizeof(tex));
-  }
-
-  // Generate texture map from board state
-  BlockTextureMap(unsigned int block_x, unsigned int block_y, const BoardState & board) {
-    bool context[3][3];
-
-    for(auto x = 0; x < 3; x++) {
-      for(auto y = 0; y < 3; y++) {
-        auto pos_x = block_x + x - 1;
-        auto pos_y = block_y + y - 1;
-        context[x][y] = pos_x >= 0 && pos_x < board.size() &&
-                        pos_y >= 0 && pos_y < board[pos_x].size() &&
-                        board[block_x][block_y] == board[pos_x][pos_y];
-      }
-    }
-
-    initialize(context, board[block_x][block_y].color);
-  }
-
-  // Generate texture map based on individual tetromino
-  BlockTextureMap(unsigned int block_x, unsigned int block_y, const Tetromino & piece) {
-    bool context[3][3];
-
-    for(auto x = 0; x < 3; x++) {
-      for(auto y = 0; y < 3; y++) {
-        int pos_x = block_x + x - 1;
-        int pos_y = block_y + y - 1;
-        context[x][y] = pos_x >= 0 && pos_x < piece.width &&
-                        pos_y >= 0 && pos_y < piece.height &&
-                        piece.getBlock(pos_x, pos_y).color != 0;
-      }
-    }
-
-    initialize(context, piece.getBlock(block_x, block_y).color);
-  }
-
-  // From context of surrounding blocks, determine which textures to use to
-  // draw this block -- this consists of four corners, four edges, and the
-  // center, which is always the same.
-  void initialize(bool ctx[3][3], unsigned int block_color) {
-    color = colors.at(block_color);
-
-    tex[0][0] = ctx[1][0] && ctx[0][1] && ctx[0][0] ? tex_block_bg :
-                ctx[1][0] && ctx[0][1]              ? tex_block_inner :
-                ctx[1][0]                           ? tex_block_left :
-                ctx[0][1]                           ? tex_block_bottom :
-                                                      tex_block_outer;
-    tex[0][1] = ctx[0][1] ? tex_block_bg : tex_block_left;
-    tex[0][2] = ctx[1][2] && ctx[0][1] && ctx[0][2] ? tex_block_bg :
-                ctx[1][2] && ctx[0][1]              ? tex_block_inner :
-                ctx[1][2]                           ? tex_block_left :
-                ctx[0][1]                           ? tex_block_top :
-                                                      tex_block_outer;
-    tex[1][0] = ctx[1][0] ? tex_block_bg : tex_block_bottom;
-    tex[1][1] = tex_block_bg;
-    tex[1][2] = ctx[1][2] ? tex_block_bg : tex_block_top;
-    tex[2][0] = ctx[1][0] && ctx[2][1] && ctx[2][0] ? tex_block_bg :
-                ctx[1][0] && ctx[2][1]              ? tex_block_inner :
-                ctx[1][0]                           ? tex_block_right :
-                ctx[2][1]                           ? tex_block_bottom :
-                                                      tex_block_outer;
-    tex[2][1] = ctx[2][1] ? tex_block_bg : tex_block_right;
-    tex[2][2] = ctx[1][2] && ctx[2][1] && ctx[2][2] ? tex_block_bg :
-                ctx[1][2] && ctx[2][1]              ? tex_block_inner :
-                ctx[1][2]                           ? tex_block_right :
-                ctx[2][1]                           ? tex_block_top :
-                                                      tex_block_outer;
-  }
-
-  bool operator==(const BlockTextureMap & other) {
-    return memcmp(tex, other.tex, sizeof(tex)) == 0 && color == other.color;
-  }
-
-  bool operator!=(const BlockTextureMap & other) {
-    return !operator==(other);
+////////////////////////////////////////////////////////////////////////////////
+void DrawDigits(RenderBackend & backend, float x, float y, int n_digits, unsigned int score,
+                float width = 1.0f, unsigned int rgb = 0xFFFFFF) {
+  char digits[n_digits + 1];
+  snprintf(digits, sizeof(digits), "%.*u", n_digits, score);
+  
+  for(int i = 0; i < n_digits; i++) {
+    backend.addBox(assets.digits[digits[i] - '0'], x + i * width, y, width, 2 * width, rgb);
   }
-};
-
-typedef std::array<std::array<BlockTextureMap, BOARD_HEIGHT>, BOARD_WIDTH> BoardTextureMap;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
-void DrawBox(GLfloat x, GLfloat y, GLfloat w, GLfloat h) {
-  glBegin(GL_QUADS);
-  glTexCoord2f(0.0f, 1.0f);
-  glVertex2f(x, y);
-  glTexCoord2f(0.0f, 0.0f);
-  glVertex2f(x, y + h);
-  glTexCoord2f(1.0f, 0.0f);
-  glVertex2f(x + w, y + h);
-  glTexCoord2f(1.0f, 1.0f);
-  glVertex2f(x + w, y);
-  glEnd();
+// Half size digits over the top left of the board, averaged over the last
+// frames drawn
+static void DrawOverlay(RenderBackend & backend) {
+  FrameSample mean = frame_stats.average();
+  const unsigned int values[OVERLAY_ROWS] = {
+    mean.fetch_ns / 1000, mean.shapes_ns / 1000, mean.submit_ns / 1000, mean.flush_ns / 1000,
+    mean.blocks, mean.quads, mean.calls};
+
+  for(int row = 0; row < OVERLAY_ROWS; row++) {
+    DrawDigits(backend, BOARD_INSET + 0.25f, BOARD_HEIGHT - 1.25f - row, 4,
+               values[row] > 9999 ? 9999 : values[row], 0.5f, overlay_colors[row]);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void DrawBlockPart(float x, float y, float w, float h, GLuint tex) {
-  glBindTexture(GL_TEXTURE_2D, tex);
-
-  glPushMatrix();
-  glTranslatef(x, y, 0.0f);
-
-  glBegin(GL_QUADS);
-  glTexCoord2f(x, 1.0f - y);
-  glVertex2f(0.0f, 0.0f);
-  glTexCoord2f(x, 1.0f - y - h);
-  glVertex2f(0.0f, h);
-  glTexCoord2f(x + w, 1.0f - y - h);
-  glVertex2f(w, h);
-  glTexCoord2f(x + w, 1.0f - y);
-  glVertex2f(w, 0.0f);
-  glEnd();
-
-  glPopMatrix();
+// CPU time used by the calling thread
+static uint64_t threadCpuNs() {
+  timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Draw a block at x,y using a texture map
-void DrawBlock(float x, float y, const BlockTextureMap & map) {
-  glPushMatrix();
-  glTranslatef(x, y, 0.0f);
-
-  glColor3ub((map.color >> 16) & 0xFF, (map.color >> 8) & 0xFF, map.color & 0xFF);
-
-  if(map.color == 0) {
-    // Just draw an untexture box if color is black
-    DrawBox(0.0f, 0.0f, 1.0f, 1.0f);
-  } else {
-    glEnable(GL_TEXTURE_2D);
-    DrawBlockPart(0.00f, 0.75f, 0.25f, 0.25f, map.tex[0][2]);
-    DrawBlockPart(0.25f, 0.75f, 0.50f, 0.25f, map.tex[1][2]);
-    DrawBlockPart(0.75f, 0.75f, 0.25f, 0.25f, map.tex[2][2]);
-    DrawBlockPart(0.00f, 0.25f, 0.25f, 0.50f, map.tex[0][1]);
-    DrawBlockPart(0.25f, 0.25f, 0.50f, 0.50f, map.tex[1][1]);
-    DrawBlockPart(0.75f, 0.25f, 0.25f, 0.50f, map.tex[2][1]);
-    DrawBlockPart(0.00f, 0.00f, 0.25f, 0.25f, map.tex[0][0]);
-    DrawBlockPart(0.25f, 0.00f, 0.50f, 0.25f, map.tex[1][0]);
-    DrawBlockPart(0.75f, 0.00f, 0.25f, 0.25f, map.tex[2][0]);
-    glDisable(GL_TEXTURE_2D);
+// Sleep until the controller has published a state that was not drawn yet:
+// just after its next tick is due, or a frame from now if it is late. A
+// tickless controller has no next tick, but says when it publishes.
+static void WaitForTick(GameController & controller) {
+  int publish_fd = controller.getPublishFd();
+  if(publish_fd >= 0) {
+    pollfd published = {publish_fd, POLLIN, 0};
+    if(poll(&published, 1, IDLE_WAKE_MS) > 0) {
+      uint64_t count;
+      ssize_t got = read(publish_fd, &count, sizeof(count));
+      (void)got;
+    }
+    return;
   }
 
-  glPopMatrix();
-}
-
-////////////////////////////////////////////////////////////////////////////////
-// Load a texture from an image file and return GL texture ID
-GLuint LoadTexture(string file) {
-  SDL_Surface *tex = IMG_Load(file.c_str());
+  uint64_t now = monotonicNs();
+  uint64_t wake = controller.getPublishTime() + BBT_TICK_PERIOD_NS + WAKE_SLACK_NS;
 
-  if(!tex) {
-    printf("Error loading texture %s: %s", file.c_str(), IMG_GetError());
-    return 0;
+  if(wake <= now) {
+    wake = now + WAKE_SLACK_NS;
+  } else if(wake > now + BBT_TICK_PERIOD_NS) {
+    wake = now + BBT_TICK_PERIOD_NS;
   }
 
-  // Convert to RGBA format for GL
-  SDL_PixelFormat fmt;
-  fmt.palette       = 0;
-  fmt.colorkey      = 0;
-  fmt.alpha         = 0;
-  fmt.BitsPerPixel  = 32;
-  fmt.BytesPerPixel = 4;
-  fmt.Rmask = 0x000000FF; fmt.Rshift = 24; fmt.Rloss = 0;
-  fmt.Gmask = 0x0000FF00; fmt.Gshift = 16; fmt.Gloss = 0;
-  fmt.Bmask = 0x00FF0000; fmt.Bshift = 8;  fmt.Bloss = 0;
-  fmt.Amask = 0xFF000000; fmt.Ashift = 0;  fmt.Aloss = 0;
-
-  SDL_Surface *tex_rgba = SDL_ConvertSurface(tex, &fmt, SDL_SWSURFACE);
-  SDL_FreeSurface(tex);
-
-  // Load GL texture
-  GLuint tex_id;
-  glGenTextures(1, &tex_id);
-  glBindTexture(GL_TEXTURE_2D, tex_id);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex_rgba->w, tex_rgba->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex_rgba->pixels);
-  SDL_FreeSurface(tex_rgba);
-
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-  return tex_id;
+  timespec until;
+  until.tv_sec = wake / 1000000000ULL;
+  until.tv_nsec = wake % 1000000000ULL;
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-void DrawBox(GLfloat x, GLfloat y, GLfloat w, GLfloat h, GLuint tex) {
-  glEnable(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, tex);
-  glColor3ub(255, 255, 255);
-  DrawBox(x, y, w, h);
-  glDisable(GL_TEXTURE_2D);
-}
+// Main loop for display thread
+void DisplayHandler(GameController & controller, RenderBackend & backend) {
+  if(!backend.open()) exit(1);
 
-////////////////////////////////////////////////////////////////////////////////
-void DrawDigits(GLfloat x, GLfloat y, int n_digits, unsigned int score) {
-  char digits[n_digits + 1];
-  snprintf(digits, sizeof(digits), "%.*u", n_digits, score);
-  
-  for(int i = 0; i < n_digits; i++) {
-    DrawBox(x + i, y, 1, 2, digit_textures[digits[i] - '0']);
-  }
-}
+  // The bundle made at build time is ready to use as it is. Without it,
+  // decode the PNGs and compose the sprites, which takes far longer.
+  uint64_t assets_start_ns = monotonicNs();
+  latency_stats.assets_from_bundle = atlas.map(BBT_ASSET_BUNDLE) && findAssets(atlas, assets);
 
-////////////////////////////////////////////////////////////////////////////////
-// Main loop for display thread
-void DisplayHandler(GameController & controller) {
-  SDL_Init(SDL_INIT_VIDEO);
-  SDL_ShowCursor(0);
-  SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
-  SDL_GL_SetAttribute(SDL_GL_SWAP_CONTROL, 1);
-
-  // Attempt to create portrait orientation surface
-  SDL_Surface *surface = SDL_SetVideoMode(SCREEN_WIDTH, SCREEN_HEIGHT, 0, SDL_OPENGL | SDL_FULLSCREEN);
-
-  // If we fail to create the first surface, assume that we're running
-  // in landscape on the LCD CAPE and rotate here
-  bool rotate_display = false;
-  if(surface == NULL) {
-    rotate_display = true;
-    surface = SDL_SetVideoMode(SCREEN_HEIGHT, SCREEN_WIDTH, 0, SDL_OPENGL | SDL_FULLSCREEN);
+  if(!latency_stats.assets_from_bundle) {
+    atlas.clear();
+    loadAssetImages(atlas, assets, "");
   }
 
-  // Still failed. WTF?
-  if(surface == NULL) {
-    printf("Failed to create video surface: %s\n", SDL_GetError());
-    exit(1);
-  }
+  if(!backend.load(atlas)) exit(1);
+  latency_stats.assets_ns = monotonicNs() - assets_start_ns;
+
+  // Draw static top bar and initial score/level values
+  backend.addBox(assets.background, 0.0f, 0.0f, 14.0f, AREA_HEIGHT);
+  DrawDigits(backend, 1.0f, AREA_HEIGHT - 3, 6, 0);
+  DrawDigits(backend, 8.0f, AREA_HEIGHT - 3, 1, 0);
+  backend.addBox(assets.paused, BOARD_INSET, 0.0f, 10.0f, 20.0f);
+  backend.flush();
 
-  // Don't let SDL stomp on these
-  signal(SIGINT, SIG_DFL);
-  signal(SIGTERM, SIG_DFL);
+  latency_stats.first_frame_ns = monotonicNs();
+  latency_stats.printStartup(stdout);
 
-  // Set up projection -- reversed if display rotated
-  glViewport(0, 0, surface->w, surface->h);
-  glMatrixMode(GL_PROJECTION);
-  glLoadIdentity();
+  GameState game;
+  GameStatus last_status;
+  BoardView view;
+  ShapeMap shapes;
 
-  if(rotate_display) {
-    gluOrtho2D(0.0, AREA_HEIGHT, 0.0, AREA_WIDTH);
-  } else {
-    gluOrtho2D(0.0, AREA_WIDTH, 0.0, AREA_HEIGHT);
-  }
+  controller.getGameState(game);
+  view.reset(game);
 
-  glMatrixMode(GL_MODELVIEW);
-  glLoadIdentity();
+  latency_stats.display_start_ns = monotonicNs();
+  latency_stats.display_start_cpu_ns = threadCpuNs();
 
-  // If rotated, rotate around center and return to bottom-left corner
-  if(rotate_display) {
-    glTranslatef(AREA_HEIGHT / 2.0, AREA_WIDTH / 2.0, 0.0);
-    glRotatef(-90.0f, 0.0f, 0.0f, 1.0f);
-    glTranslatef(-AREA_WIDTH / 2.0, -AREA_HEIGHT / 2.0, 0.0);
-  }
+  // Whatever was under the overlay is drawn again when it is turned off
+  bool overlay_shown = false;
 
-  // Load textures
-  tex_bg           = LoadTexture(string("background.png"));
-  tex_block_bg     = LoadTexture(string("block_bg.png"));
-  tex_block_outer  = LoadTexture(string("block_outer.png"));
-  tex_block_inner  = LoadTexture(string("block_inner.png"));
-  tex_block_top    = LoadTexture(string("block_top.png"));
-  tex_block_bottom = LoadTexture(string("block_bottom.png"));
-  tex_block_left   = LoadTexture(string("block_left.png"));
-  tex_block_right  = LoadTexture(string("block_right.png"));
-  tex_paused       = LoadTexture(string("paused.png"));
-  tex_game_over    = LoadTexture(string("game_over.png"));
-
-  for(int i = 0; i <= 9; i++) {
-    digit_textures.push_back(LoadTexture(string("digit") + std::to_string(i) + ".png"));
-  }
+  // Only wake up when the controller has published, and only draw and swap
+  // if something on screen changed
+  while(true) {
+    latency_stats.display_wall_ns = monotonicNs();
+    latency_stats.display_cpu_ns = threadCpuNs();
+    if(latency_stats.dumpIfRequested(stdout)) frame_stats.print(stdout);
+
+    if(!backend.poll() || frame_stats.quit_requested) {
+      latency_stats.dump(stdout);
+      frame_stats.print(stdout);
+      frame_stats.save();
+      unlinkStatCounters();
+      return;
+    }
 
-  // Initialize display
-  glDisable(GL_DEPTH_TEST);
-  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-  glClear(GL_COLOR_BUFFER_BIT);
+    bool toggled = overlay_shown != (frame_stats.overlay != 0);
+    if(controller.peekDelta() == NULL && !toggled) {
+      WaitForTick(controller);
+      continue;
+    }
 
-  // Draw static top bar and initial score/level values
-  DrawBox(0.0f, 0.0f, 14.0f, AREA_HEIGHT, tex_bg);
-  DrawDigits(1.0f, AREA_HEIGHT - 3, 6, 0);
-  DrawDigits(8.0f, AREA_HEIGHT - 3, 1, 0);
-  DrawBox(BOARD_INSET, 0.0f, 10.0f, 20.0f, tex_paused);
+    bool cover_overlay = toggled && overlay_shown;
+    overlay_shown = frame_stats.overlay != 0;
+
+    FrameSample frame;
+    memset(&frame, 0, sizeof(frame));
+    uint64_t fetch_ns = monotonicNs();
+
+    // Catch up with the game from the change records, or from a full copy of
+    // the state if too much has changed. Records the copy already covers are
+    // skipped. Follow the earliest input of the ones shown to the screen.
+    uint64_t input_ns = 0, tick_ns = 0;
+    const GameDelta *delta;
+    while((delta = controller.peekDelta()) != NULL) {
+      if(delta->seq > view.getSeq()) {
+        if(!view.apply(*delta)) {
+          controller.getGameState(game);
+          view.reset(game);
+          stat_counters->resyncs.fetch_add(1, std::memory_order_relaxed);
+        }
+        if(input_ns == 0) {
+          input_ns = delta->input_ns;
+          tick_ns = delta->tick_ns;
+        }
+      }
+      controller.popDelta();
+    }
 
-  GameState game, last_game;
-  BoardTextureMap curr_board, last_board;
+    uint64_t submit_ns = monotonicNs();
+    frame.fetch_ns = submit_ns - fetch_ns;
 
-  // Redraw display as fast as we can (not at all fast)
-  while(true) {
-    last_game = game;
-    controller.getGameState(game);
+    const GameStatus & status = view.getStatus();
 
     // Draw score
-    if(game.score != last_game.score) {
-      DrawDigits(1.0f, AREA_HEIGHT - 3, 6, game.score);
+    if(status.score != last_status.score) {
+      DrawDigits(backend, 1.0f, AREA_HEIGHT - 3, 6, status.score);
     }
 
     // Draw level
-    if(game.level != last_game.level) {
-      DrawDigits(8.0f, AREA_HEIGHT - 3, 1, game.level);
+    if(status.level != last_status.level) {
+      DrawDigits(backend, 8.0f, AREA_HEIGHT - 3, 1, status.level);
     }
 
     // Draw next tetromino
-    if(game.next != last_game.next) {
-      glPushMatrix();
-      glTranslatef(11.5f, AREA_HEIGHT - 2.0f, 0.0f);
-      
+    if(status.next != last_status.next) {
       // Just blank out the whole area
-      glColor3ub(0, 0, 0);
-      DrawBox(-1.5f, -1.5f, 3.0f, 3.0f);
+      backend.addBox(TextureAtlas::WHITE, 10.0f, AREA_HEIGHT - 3.5f, 3.0f, 3.0f, 0x000000);
 
       // Scale down a bit so it fits
-      glScalef(0.75f, 0.75f, 0.0f);
-      
-      for(auto x = 0; x < game.next.width; x++) {
-          for(auto y = 0; y < game.next.height; y++) {
-              auto center = game.next.getCenter();
-
-              BlockTextureMap block_tex = BlockTextureMap(x, y, game.next);
+      auto center = status.next.getCenter();
+      for(auto x = 0; x < status.next.width; x++) {
+          for(auto y = 0; y < status.next.height; y++) {
+              BlockTextureMap block_tex = BlockTextureMap(x, y, status.next);
               if(block_tex.color != 0) {
-                DrawBlock(x - center.first, y - center.second, block_tex);
+                backend.addBlock(11.5f + (x - center.first) * 0.75f,
+                               AREA_HEIGHT - 2.0f + (y - center.second) * 0.75f, 0.75f, block_tex);
               }
           }
       }
-      glPopMatrix();
     }
 
     // Draw game area
-    glPushMatrix();
-    glTranslatef(BOARD_INSET, 0.0f, 0.0f);
-
-    if(!game.game_over && !game.paused) {
-      bool refresh = last_game.game_over || last_game.paused;
-
-      // Draw game board
-      game.active.place(game.board); // Draw with active tetromino
+    if(!status.game_over && !status.paused) {
+      bool refresh = last_status.game_over || last_status.paused || cover_overlay;
+      const BoardState & shown = view.getShown(); // Board with active tetromino
+
+      // Only work out the shapes of blocks that may have changed since the
+      // last frame, and only draw those that did
+      uint64_t shapes_ns = monotonicNs();
+      if(refresh) {
+        shapes.updateAll(shown);
+      } else {
+        shapes.update(shown, view.getRedrawRows());
+      }
+      frame.shapes_ns = monotonicNs() - shapes_ns;
 
-      for(unsigned int x = 0; x < game.board.size(); x++)  {
-        for(unsigned int y = 0; y < game.board[x].size(); y++) {
-          curr_board[x][y] = BlockTextureMap(x, y, game.board);
+      for(unsigned int y = 0; y < BOARD_HEIGHT; y++) {
+        RowMask draw = refresh ? FULL_ROW_MASK : shapes.getChanged(y);
 
-          // Redraw block only if it has changed since the last frame
-          if(curr_board[x][y] != last_board[x][y] || refresh) {
-            DrawBlock(x, y, curr_board[x][y]);
+        for(unsigned int x = 0; draw; x++, draw >>= 1) {
+          if(draw & 1) {
+            backend.addBlock(BOARD_INSET + x, y, 1.0f, BlockTextureMap(shapes.get(x, y)));
+            frame.blocks++;
           }
         }
       }
 
-      last_board = curr_board;
+      shapes.clearChanged();
+      view.clearRedraw();
 
-    } else if(game.game_over && !last_game.game_over) {
+    } else if(status.game_over && (!last_status.game_over || cover_overlay)) {
       // Draw "GAME OVER" message
-      DrawBox(0.0f, 0.0f, 10.0f, 20.0f, tex_game_over);
+      backend.addBox(assets.game_over, BOARD_INSET, 0.0f, 10.0f, 20.0f);
 
-    } else if(game.paused && !last_game.paused) {
+    } else if(status.paused && (!last_status.paused || cover_overlay)) {
       // Draw "PAUSED" message
-      DrawBox(0.0f, 0.0f, 10.0f, 20.0f, tex_paused);
+      backend.addBox(assets.paused, BOARD_INSET, 0.0f, 10.0f, 20.0f);
+
+    }
+
+    last_status = status;
 
+    // The state moved on but nothing looks different
+    if(backend.empty() && !toggled) {
+      latency_stats.frames_skipped++;
+      stat_counters->frames_skipped.fetch_add(1, std::memory_order_relaxed);
+      continue;
     }
 
-    glPopMatrix();
+    // Drawn over whatever changed under it, showing the frames before
+    uint64_t draw_ns = monotonicNs();
+    frame.submit_ns = draw_ns - submit_ns - frame.shapes_ns;
+    if(overlay_shown) DrawOverlay(backend);
 
-    SDL_GL_SwapBuffers();
+    // Everything that changed, e.g. in one draw call from the atlas with GL
+    backend.flush();
+    uint64_t swap_ns = monotonicNs();
+
+    frame.flush_ns = swap_ns - draw_ns;
+    frame.quads = backend.getLastFlush().quads;
+    frame.calls = backend.getLastFlush().calls;
+    frame_stats.record(frame);
+
+    stat_counters->frames_drawn.fetch_add(1, std::memory_order_relaxed);
+    stat_counters->blocks_redrawn.fetch_add(frame.blocks, std::memory_order_relaxed);
+    stat_counters->flush_ns.fetch_add(frame.flush_ns, std::memory_order_relaxed);
+
+    if(input_ns != 0) {
+      latency_stats.tick_to_draw.record(draw_ns - tick_ns);
+      latency_stats.draw_to_swap.record(swap_ns - draw_ns);
+      latency_stats.input_to_swap.record(swap_ns - input_ns);
+    }
+    latency_stats.frames_drawn++;
   }
 }
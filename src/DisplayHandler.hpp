@@ -2,8 +2,10 @@
 #define DISPLAY_HANDLER_H
 
 #include "GameController.hpp"
+#include "RenderBackend.hpp"
 
-// Main function for display thread
-void DisplayHandler(GameController & controller);
+// Main function for display thread, drawing through backend. Returns once
+// the user quits.
+void DisplayHandler(GameController & controller, RenderBackend & backend);
 
 #endif
@@ -0,0 +1,149 @@
+#include "EventRing.hpp"
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// Made up by drain to match the held buttons, indexed by held bit number
+static const int start_events[] = {EV_START_LEFT, EV_START_RIGHT, EV_START_DOWN};
+static const int stop_events[]  = {EV_STOP_LEFT, EV_STOP_RIGHT, EV_STOP_DOWN};
+static const int n_held_buttons = 3;
+
+////////////////////////////////////////////////////////////////////////////////
+EventRing::EventRing() : enqueue_pos(0), held(0), dropped(0), notify_fd(-1),
+                         dequeue_pos(0), held_seen(0), dropped_seen(0) {
+  for(uint32_t i = 0; i < size; i++) {
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+EventRing::~EventRing() {
+  int fd = notify_fd.load(std::memory_order_relaxed);
+  if(fd >= 0) close(fd);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int EventRing::enableNotify() {
+  int fd = notify_fd.load(std::memory_order_relaxed);
+  if(fd < 0) {
+    fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    notify_fd.store(fd, std::memory_order_release);
+  }
+  return fd;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Wake a consumer sleeping on the eventfd, if there is one. Every
+///        push does.
+void EventRing::wake() {
+  int fd = notify_fd.load(std::memory_order_acquire);
+  if(fd >= 0) {
+    uint64_t one = 1;
+    ssize_t written = write(fd, &one, sizeof(one));
+    (void)written;   // only fails if the count would overflow, still readable
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Held bit of the button a START or STOP event is about
+/// \returns 0 for events that are not about a held button
+int EventRing::heldBit(int event) {
+  for(int i = 0; i < n_held_buttons; i++) {
+    if(event == start_events[i] || event == stop_events[i]) return 1 << i;
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool EventRing::isStart(int event) {
+  return event == EV_START_LEFT || event == EV_START_RIGHT || event == EV_START_DOWN;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Queue an event, or count it as dropped if the ring is full. Slots
+///        are claimed with a compare and swap on the write position and each
+///        slot's sequence number tells whose turn it is (Vyukov's bounded
+///        queue), so producers only ever retry, never wait.
+/// \returns False if the event was dropped
+bool EventRing::push(int event, uint64_t time_ns, uint64_t kernel_ns) {
+  int bit = heldBit(event);
+  if(isStart(event)) {
+    held.fetch_or(bit, std::memory_order_release);
+  } else if(bit) {
+    held.fetch_and(~bit, std::memory_order_release);
+  }
+
+  uint32_t pos = enqueue_pos.load(std::memory_order_relaxed);
+  while(true) {
+    Slot & slot = slots[pos & (size - 1)];
+    int32_t diff = (int32_t)(slot.sequence.load(std::memory_order_acquire) - pos);
+
+    if(diff == 0) {
+      // Free slot, try to claim it. On failure pos is reloaded.
+      if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        slot.data.event = event;
+        slot.data.time_ns = time_ns;
+        slot.data.kernel_ns = kernel_ns;
+        slot.sequence.store(pos + 1, std::memory_order_release);
+        wake();
+        return true;
+      }
+    } else if(diff < 0) {
+      // The consumer has not freed this slot yet, the ring is full
+      dropped.fetch_add(1, std::memory_order_release);
+      wake();
+      return false;
+    } else {
+      // Another producer got here first
+      pos = enqueue_pos.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Take queued events, then make up for dropped START and STOP events
+/// \returns Number of events stored in out
+unsigned int EventRing::drain(InputEvent * out, unsigned int max_events) {
+  unsigned int n_events = 0;
+  bool empty = false;
+
+  while(n_events < max_events) {
+    Slot & slot = slots[dequeue_pos & (size - 1)];
+    if(slot.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+      empty = true;
+      break;
+    }
+
+    InputEvent & event = out[n_events++];
+    event = slot.data;
+    slot.sequence.store(dequeue_pos + size, std::memory_order_release);
+    dequeue_pos++;
+
+    int bit = heldBit(event.event);
+    if(isStart(event.event)) {
+      held_seen |= bit;
+    } else {
+      held_seen &= ~bit;
+    }
+  }
+
+  // Only after everything queued before the drop was passed on, or the made
+  // up events would come out of order
+  uint32_t drops = dropped.load(std::memory_order_acquire);
+  if(empty && drops != dropped_seen && max_events - n_events >= (unsigned int)n_held_buttons) {
+    dropped_seen = drops;
+    uint32_t now_held = held.load(std::memory_order_acquire);
+
+    for(int i = 0; i < n_held_buttons; i++) {
+      int bit = 1 << i;
+      if(!((now_held ^ held_seen) & bit)) continue;
+
+      out[n_events].event = now_held & bit ? start_events[i] : stop_events[i];
+      out[n_events].time_ns = 0;
+      out[n_events].kernel_ns = 0;
+      n_events++;
+    }
+    held_seen = now_held;
+  }
+
+  return n_events;
+}
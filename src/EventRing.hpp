@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the EventRing class: carries input events from any number of
+/// reader threads to the game controller without syscalls or locks.
+///
+/// Producers never block. When the ring is full the event is dropped and
+/// counted instead. Held buttons (left, right, down) are also tracked as a
+/// level word next to the ring, so after a drop the consumer adds whatever
+/// START or STOP events are needed to match the buttons actually held. Lost
+/// press and release pairs are coalesced that way, and a button never stays
+/// stuck. Lost rotations and pauses stay lost.
+///
+/// A consumer that would rather sleep than look at the ring every tick can
+/// ask for an eventfd that every push signals, at the cost of one write
+/// syscall per event.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef EVENT_RING_H
+#define EVENT_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include "BBTdefines.hpp"
+
+struct InputEvent {
+  int32_t event;      // one of bbtEvents
+  uint64_t time_ns;   // CLOCK_MONOTONIC when pushed, 0 if made up by drain
+  uint64_t kernel_ns; // CLOCK_MONOTONIC the device reported it at, 0 if unknown
+};
+
+class EventRing {
+public:
+  static const uint32_t size = BBT_EVENT_RING_SIZE;
+
+  EventRing();
+  ~EventRing();
+
+  // Any thread. Returns false if the event was dropped.
+  bool push(int event, uint64_t time_ns, uint64_t kernel_ns = 0);
+
+  // Consumer thread only. Moves up to max_events events to out, oldest first,
+  // and returns how many. Once the ring is empty after a drop, up to three
+  // made up events bring the held buttons back in line.
+  unsigned int drain(InputEvent * out, unsigned int max_events);
+
+  // Consumer thread, or before it starts. From now on every push, dropped
+  // or not, adds to an eventfd, which becomes readable until the consumer
+  // reads it. Read it before draining, so a push after the drain wakes the
+  // consumer again. Returns the eventfd, or -1 if it can't be created.
+  int enableNotify();
+
+  // Any thread. Make the eventfd readable without queuing anything, e.g. to
+  // get the consumer to look at something else. Does nothing before
+  // enableNotify.
+  void wake();
+
+  uint32_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+  static_assert((size & (size - 1)) == 0, "EventRing size must be a power of two");
+
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    InputEvent data;
+  };
+
+  static int heldBit(int event);
+  static bool isStart(int event);
+
+  Slot slots[size];
+  std::atomic<uint32_t> enqueue_pos;
+  std::atomic<uint32_t> held;      // buttons down, as last reported by producers
+  std::atomic<uint32_t> dropped;
+  std::atomic<int> notify_fd;      // -1 until enableNotify
+
+  // Consumer only
+  uint32_t dequeue_pos;
+  uint32_t held_seen;              // buttons down, as passed on by drain
+  uint32_t dropped_seen;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include <string.h>
+#include "FrameStats.hpp"
+
+FrameStats frame_stats;
+
+////////////////////////////////////////////////////////////////////////////////
+static void toggleOverlay(int) {
+  frame_stats.overlay = !frame_stats.overlay;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void requestQuit(int) {
+  frame_stats.quit_requested = 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FrameStats::FrameStats() : overlay(0), quit_requested(0), n_frames(0) {
+  memset(window, 0, sizeof(window));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FrameStats::installSignals() {
+  signal(SIGUSR2, toggleOverlay);
+  signal(SIGINT, requestQuit);
+  signal(SIGTERM, requestQuit);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FrameStats::record(const FrameSample & frame) {
+  fetch.record(frame.fetch_ns);
+  shapes.record(frame.shapes_ns);
+  submit.record(frame.submit_ns);
+  flush.record(frame.flush_ns);
+  blocks.record(frame.blocks);
+  quads.record(frame.quads);
+  calls.record(frame.calls);
+
+  window[n_frames++ % WINDOW] = frame;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+FrameSample FrameStats::average() const {
+  uint64_t sum[7] = {0, 0, 0, 0, 0, 0, 0};
+  unsigned int n = n_frames < WINDOW ? n_frames : WINDOW;
+
+  for(unsigned int i = 0; i < n; i++) {
+    const FrameSample & frame = window[i];
+    sum[0] += frame.fetch_ns;
+    sum[1] += frame.shapes_ns;
+    sum[2] += frame.submit_ns;
+    sum[3] += frame.flush_ns;
+    sum[4] += frame.blocks;
+    sum[5] += frame.quads;
+    sum[6] += frame.calls;
+  }
+
+  FrameSample mean;
+  memset(&mean, 0, sizeof(mean));
+  if(n == 0) return mean;
+
+  mean.fetch_ns = sum[0] / n;
+  mean.shapes_ns = sum[1] / n;
+  mean.submit_ns = sum[2] / n;
+  mean.flush_ns = sum[3] / n;
+  mean.blocks = sum[4] / n;
+  mean.quads = sum[5] / n;
+  mean.calls = sum[6] / n;
+  return mean;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void FrameStats::print(FILE * out) const {
+  fprintf(out, "frame time:\n");
+  fetch.print(out, "  fetch");
+  shapes.print(out, "  shapes");
+  submit.print(out, "  submit");
+  flush.print(out, "  flush");
+  fprintf(out, "per frame:\n");
+  blocks.printCounts(out, "  blocks redrawn");
+  quads.printCounts(out, "  quads");
+  calls.printCounts(out, "  driver calls");
+  fflush(out);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The summary first, then every bucket, times in ns
+bool FrameStats::save() const {
+  if(save_file.empty()) return true;
+
+  FILE * out = fopen(save_file.c_str(), "w");
+  if(out == NULL) {
+    printf("Failed to create %s\n", save_file.c_str());
+    return false;
+  }
+
+  print(out);
+  fetch.write(out, "fetch_ns");
+  shapes.write(out, "shapes_ns");
+  submit.write(out, "submit_ns");
+  flush.write(out, "flush_ns");
+  blocks.write(out, "blocks");
+  quads.write(out, "quads");
+  calls.write(out, "calls");
+
+  if(fclose(out) != 0) {
+    printf("Failed to write %s\n", save_file.c_str());
+    return false;
+  }
+  return true;
+}
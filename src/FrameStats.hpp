@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the display's per-frame statistics. Every frame drawn is
+/// split into four stages, all on CLOCK_MONOTONIC:
+///   fetch  - taking the controller's change records, or its full state
+///   shapes - working out the block shapes that changed (ShapeMap)
+///   submit - adding the quads for everything that changed to the backend
+///   flush  - the backend's flush, with GL including the buffer swap
+/// along with how many board blocks were redrawn and the quads and driver
+/// calls the flush took. Histograms cover the whole run and are printed
+/// with the SIGUSR1 dump and written to a file at exit; the means over the
+/// last few frames are what the overlay shows. SIGUSR2 toggles the overlay.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <signal.h>
+#include <stdio.h>
+#include <cstdint>
+#include <string>
+#include "Histogram.hpp"
+
+struct FrameSample {
+  uint32_t fetch_ns;
+  uint32_t shapes_ns;
+  uint32_t submit_ns;
+  uint32_t flush_ns;
+  uint32_t blocks;
+  uint32_t quads;
+  uint32_t calls;
+};
+
+struct FrameStats {
+  // Frames the overlay averages over
+  static const unsigned int WINDOW = 32;
+
+  Histogram fetch;
+  Histogram shapes;
+  Histogram submit;
+  Histogram flush;
+  Histogram blocks;
+  Histogram quads;
+  Histogram calls;
+
+  std::string save_file;      // written at exit if set
+
+  volatile sig_atomic_t overlay;          // show the overlay
+  volatile sig_atomic_t quit_requested;   // SIGINT or SIGTERM
+
+  FrameStats();
+
+  // Install the SIGUSR2 handler that toggles the overlay, and SIGINT and
+  // SIGTERM handlers so that the display can save before exiting
+  void installSignals();
+
+  // Only called by the display thread
+  void record(const FrameSample & frame);
+
+  // Mean of the last WINDOW frames recorded
+  FrameSample average() const;
+
+  void print(FILE * out) const;
+
+  // Write the histograms to save_file, if set. Prints why and returns false
+  // if it can't.
+  bool save() const;
+
+private:
+  FrameSample window[WINDOW];
+  unsigned int n_frames;
+};
+
+extern FrameStats frame_stats;
+
+#endif
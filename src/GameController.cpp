@@ -1,5 +1,5 @@
 ///////////////////////////////////////////////////////////////////////////////
-/// \file implement the InputHandler class
+/// \file implement the GameController class
 ///////////////////////////////////////////////////////////////////////////////
 
 // this module's h file.
@@ -7,11 +7,14 @@
 
 // external includes
 /// xenomai/posix includes
-#include <mqueue.h>
 #ifdef NOXENOMAI
 #include <pthread.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #else
 #include <native/task.h>
+#include <native/timer.h>
 
 #include <xenomai/posix/pthread.h>
 #include <sys/time.h>
@@ -28,30 +31,37 @@
 
 // local includes
 #include "BBTdefines.hpp"
+#include "LatencyStats.hpp"
+#include "StatCounters.hpp"
+#include "TickTimer.hpp"
 
 // defines
-#define TICKS_TIL_DROP_MAX 100
-#define TICKS_TIL_DROP_MIN 1
-#define FULL_LINE_COLOR_MAX 7
-
 #define TASK_PRIO  99 /* Highest RT priority */
-#define TASK_MODE  0  /* No flags */
+#define TASK_MODE  T_JOINABLE /* so stop can wait for it */
 #define TASK_STKSZ 0  /* Stack size (use default one) */
+#define JOURNAL_FLUSH_TICKS 60
 
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief
 ///
 GameController :: GameController ()
+  : running ( false )
+  , pending_input_ns ( 0 )
+  , pending_tick_ns ( 0 )
+  , publish_ns ( 0 )
+  , publish_fd ( -1 )
+  , journal_flush_tick ( 0 )
+  , journal_lost ( 0 )
 {
-  pthread_mutex_init ( &output_lock , NULL ) ;
-  input_queue = mq_open ( BBT_EVENT_QUEUE_NAME
-                      , O_RDONLY | O_NONBLOCK ) ;
-
-  if ( input_queue < 0 )
-  {
-    rt_printf ( "GameController: failed to open queue" ) ;
-  }
-  reset () ;
+  timespec now ;
+  clock_gettime ( CLOCK_REALTIME , &now ) ;
+  seed = ( ( uint64_t ) now . tv_sec << 32 ) ^ now . tv_nsec ;
+#ifdef NOXENOMAI
+  timer = NULL ;
+  tickless = false ;
+#endif
+  engine . reset ( seed ) ;
+  publish () ;
 }
 
 
@@ -60,8 +70,9 @@ GameController :: GameController ()
 ///
 GameController :: ~GameController ()
 {
-
-  pthread_mutex_destroy ( &output_lock ) ;
+  stop () ;
+  if ( publish_fd >= 0 )
+    close ( publish_fd ) ;
 }
 
 
@@ -71,7 +82,6 @@ GameController :: ~GameController ()
 void GameController :: start ()
 {
 #ifdef NOXENOMAI
-  reset () ;
   pthread_attr_t attr ;
   pthread_attr_init ( &attr ) ;
   int policy = 0 ;
@@ -86,21 +96,29 @@ void GameController :: start ()
 
   rt_printf ( "GameController starting thread \n" ) ;
   
+  running . store ( true ) ;
   retval = pthread_create ( &thread , &attr ,  ( void* (*) ( void*) ) ( threadFunc ) , this ) ;
   rt_printf ( "create_thread ret %d\n" , retval ) ;
+  if ( retval != 0 )
+    running . store ( false ) ;
   pthread_setschedprio ( thread , max_prio_for_policy ) ;
   pthread_attr_destroy ( &attr ) ;
   rt_printf ( "created_thread_id %d\n" , thread ) ;
 #else
 
-  RT_TASK thread_desc ;
-  int err = rt_task_create ( &thread_desc
+  running . store ( true ) ;
+  int err = rt_task_create ( &task
                            , "game logic"
                            , TASK_STKSZ
                            , TASK_PRIO
                            , TASK_MODE ) ;
   if ( !err )
-    rt_task_start ( &thread_desc , threadFunc , this ) ;
+    err = rt_task_start ( &task , threadFunc , this ) ;
+  if ( err )
+  {
+    rt_printf ( "GameController: failed to start task %d\n" , err ) ;
+    running . store ( false ) ;
+  }
 
 
 #endif
@@ -109,261 +127,282 @@ void GameController :: start ()
 
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief reset - initializes the game board for a new game
+/// \brief stop the thread and wait for it, then terminate and close the
+///   journal, saying so if it lost records. The display thread calls it on
+///   quit, as bbt exits without destroying the controller
 ///
-void GameController :: reset ()
+void GameController :: stop ()
 {
-  ticks_til_drop = TICKS_TIL_DROP_MAX ;
-  tick_count = 0 ;
-  game_state . reset () ;
-  full_lines . clear () ;
+  if ( running . exchange ( false ) )
+  {
+#ifdef NOXENOMAI
+    // a tickless thread sleeps until input
+    input_ring . wake () ;
+    pthread_join ( thread , NULL ) ;
+#else
+    rt_task_join ( &task ) ;
+#endif
+  }
+  if ( journal . isOpen () && !journal . close ( engine . getTick () ) )
+  {
+    rt_printf ( "GameController: journal is incomplete, %u records lost%s\n"
+              , journal . getLost ()
+              , journal . hasWriteFailed () ? ", writing failed" : "" ) ;
+  }
+  countJournalLost () ;
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief copies the current data to the out_state passed to this function
-/// \return true on success (always true)
+/// \brief choose the piece sequence mode. Must be called before start
 ///
-bool GameController :: getGameState ( GameState &out_state )
+void GameController :: setPieceMode ( PieceGenerator :: Mode mode )
 {
-  pthread_mutex_lock ( &output_lock ) ;
-  out_state = game_state ;
-  pthread_mutex_unlock ( &output_lock ) ;
-  return true ;
+  engine . setPieceMode ( mode ) ;
+  engine . reset ( seed ) ;
+  publish () ;
 }
 
 
 
-
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief lower the current block one square. If it is at an end, load the next
-///   block
+/// \brief restart the game and record its seed and every consumed event to
+///   filename. Must be called before start
 /// \return true on success
 ///
-bool GameController :: downTick ()
+bool GameController :: startJournal ( const char* filename )
 {
-  //if the current block is the lowest it can be, load next
-  if(!game_state.active.tryMove(game_state.board, 0, -1, 0) )
+  engine . reset ( seed ) ;
+  publish () ;
+  if ( !journal . open ( filename , seed , engine . snapshot () . generator . getMode () ) )
   {
-    game_state.active.place(game_state.board);
-    game_state.active = game_state.next;
-    game_state.next.reinitialize();
-
-    // If new block already intersects at the top of the board, game over
-    if (game_state.active.wouldIntersect(game_state.board, 0, 0, 0))
-    {
-      game_state . game_over = true ;
-    }
-
-    int lines = getFullLines () ;
-    
-    game_state . lines_cleared += lines ;
-    game_state . level = game_state . lines_cleared / 10 + 1 ;
-    ticks_til_drop = TICKS_TIL_DROP_MAX - ( game_state . level * 5 ) ;
-    if ( ticks_til_drop > TICKS_TIL_DROP_MAX ) // overflow
-      ticks_til_drop = 0 ;
-    
-    game_state.score += lines * lines * 10 ;
-    game_state.score++ ; // one point for each block dropped
+    rt_printf ( "GameController: failed to open journal %s\n" , filename ) ;
+    return false ;
   }
   return true ;
 }
 
 
 
+#ifdef NOXENOMAI
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief determine if any lines are full
-/// \return the number of full lines
+/// \brief choose what the thread waits on between ticks, NanosleepTimer if
+///   never called. Must be called before start, and tick_timer must outlive
+///   the thread
 ///
-int GameController :: getFullLines ()
+void GameController :: setTimer ( TickTimer* tick_timer )
 {
-  for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
-  {
-    bool line_full = true ;
-    for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
-    {
-      if ( game_state . board [ x ] [ y ] . color == 0 )
-      {
-        line_full = false ;
-        break ;
-      }
-    }
-    if ( line_full )
-    {
-      full_lines . push_back ( y ) ;
-    }
-  }
-  return full_lines . size () ;
+  timer = tick_timer ;
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief blink the full lines and then remove if count has passed.
-/// \return true on success
+/// \brief run tickless instead of waiting on the tick timer, and signal every
+///   publish on getPublishFd. Must be called before start
+/// \return false if there is no eventfd, the thread then ticks as usual
 ///
-bool GameController :: processFullLines ()
-{ 
-  if ( tick_count >= FULL_LINE_COLOR_MAX )
-  {
-    return removeFullLines () ;
-  }
-  
-  for ( unsigned int loop = 0 ; loop < full_lines . size () ; ++loop )
-  {
-    int y = full_lines [ loop ] ;
-    for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
-    {
-      game_state . board [ x ] [ y ] . color = tick_count ;
-    }
-  }
-  return true ;
+bool GameController :: setTickless ()
+{
+  if ( publish_fd < 0 )
+    publish_fd = eventfd ( 0 , EFD_NONBLOCK | EFD_CLOEXEC ) ;
+  // before the thread starts, so stop can always wake it
+  tickless = publish_fd >= 0 && input_ring . enableNotify () >= 0 ;
+  return tickless ;
+}
+#endif
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief the ring input threads push events to
+///
+EventRing& GameController :: getInputRing ()
+{
+  return input_ring ;
 }
 
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief copies the latest published state to the out_state passed to this
+///   function. Never blocks the RT thread. Must only be called from one thread
+/// \return true if the state was published since the last call
+///
+bool GameController :: getGameState ( GameState &out_state )
+{
+  bool fresh = frames . update () ;
+  out_state = frames . front () ;
+  return fresh ;
+}
+
+
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief remove the full lines and drop the remaining lines
-/// \return true on success
+/// \brief the oldest change record not yet popped. Records are in seq order.
+///   One with resync set means the reader must start over from getGameState,
+///   which is never older than any record already pushed. Must only be
+///   called from the same thread as getGameState
+/// \return NULL if the reader is up to date
 ///
-bool GameController :: removeFullLines ()
+const GameDelta* GameController :: peekDelta () const
 {
-  unsigned int line_offset = 0 ;
-  unsigned int full_line_index = 0 ;
-  for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
-  {
-    while ( full_line_index < full_lines . size ()
-        && ( y + line_offset == full_lines [ full_line_index ] ))
-    {
-      ++line_offset ;
-      ++full_line_index ;
-    }
-    if ( line_offset )
-    {
-      for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
-      {
-        if ( y + line_offset < game_state . board [ 0 ] . size () )
-          game_state . board [ x ] [ y ] = game_state . board [ x ] [ y + line_offset ] ;
-        else
-          game_state . board [ x ] [ y ] = BlockData ( 0 , 0 ) ;
-      }
-    }
-  }
-  
-  full_lines . clear () ;
-  tick_count = 0 ;
-  return true ;
+  return deltas . peek () ;
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief toggle pause state
-/// \return true on success
+/// \brief release the record returned by peekDelta
 ///
-bool GameController :: pause ()
+void GameController :: popDelta ()
 {
-  game_state . paused = !game_state . paused ;
-  if ( game_state . game_over )
-  {
-    reset () ;
-  }
-  return true ;
+  deltas . pop () ;
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief move the current block based on the input event.
-/// \return true on success
+/// \brief when the last state was published, on CLOCK_MONOTONIC. The next
+///   one is due a tick period later, so the display can sleep until then
+///
+uint64_t GameController :: getPublishTime () const
+{
+  return publish_ns . load ( std :: memory_order_acquire ) ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief an eventfd that becomes readable whenever a state is published,
+///   for a display to poll on instead of guessing from getPublishTime. Read
+///   it before looking at the deltas
+/// \return -1 unless the controller is tickless
 ///
-bool GameController :: processEvent ( int event )
+int GameController :: getPublishFd () const
 {
-  switch ( event )
+  return publish_fd ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief take what changed from the engine, hand a copy of the engine state
+///   to the reader side of frames, then push the change record. The state
+///   goes out first and carries the record's seq, so a reader that starts
+///   over from it can skip the records it already covers. While the ring is
+///   full the engine keeps collecting changes, and they go out with the next
+///   record that fits
+///
+void GameController :: publish ()
+{
+  GameDelta* delta = deltas . claim () ;
+  if ( delta )
+    engine . takeDelta ( *delta ) ;
+
+  frames . back () = engine . snapshot () ;
+  frames . publish () ;
+
+  if ( delta )
   {
-    case EV_PAUSE :
-      moving_down = moving_left = moving_right = false;
-      return pause () ;
-      break ;
-    case EV_START_LEFT :
-      moving_left = true ;
-      break ;
-    case EV_STOP_LEFT :
-      moving_left = false ;
-      break ;
-    case EV_START_RIGHT :
-      moving_right = true ;
-      break ;
-    case EV_STOP_RIGHT :
-      moving_right = false ;
-      break ;
-    case EV_ROT_LEFT :
-      if ( !game_state . paused )
-        game_state.active.tryMove(game_state.board, 0, 0, -1);
-      break ;
-    case EV_ROT_RIGHT :
-      if ( !game_state . paused )
-        game_state.active.tryMove(game_state.board, 0, 0, 1);
-      break ;
-    case EV_START_DOWN :
-      moving_down = true ;
-      break ; 
-    case EV_STOP_DOWN :
-      moving_down = false ;
-      break ;
-    default :
-      rt_printf ( "unknown event %d\n" , event ) ;    
+    delta -> input_ns = pending_input_ns ;
+    delta -> tick_ns = pending_tick_ns ;
+    pending_input_ns = pending_tick_ns = 0 ;
+    deltas . push () ;
+  }
+  else
+  {
+    stat_counters -> deltas_deferred . fetch_add ( 1 , std :: memory_order_relaxed ) ;
+  }
+
+  publish_ns . store ( monotonicNs () , std :: memory_order_release ) ;
+
+  if ( publish_fd >= 0 )
+  {
+    uint64_t one = 1 ;
+    ssize_t written = write ( publish_fd , &one , sizeof ( one ) ) ;
+    ( void ) written ;
   }
-  return false ;
 }
 
 
+
+
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief process all events and update game board state for each one
+/// \brief run idle_ticks engine ticks that came before any queued event,
+///   then collect all queued events and run n_ticks with them. The earliest
+///   input is passed on to the display with the next delta
 /// \return true on success
 ///
-bool GameController :: processTick ()
+bool GameController :: processTick ( unsigned int idle_ticks , unsigned int n_ticks )
 {
-  bool result = true ;
-  int event = 0 ;
-  pthread_mutex_lock ( &output_lock ) ;
-
-  while ( mq_receive ( input_queue
-                      , ( char* ) &event
-                      , sizeof ( event )
-                      , NULL ) != -1)
-  {
-    processEvent ( event ) ;
-  }
+  unsigned int lines_before = engine . snapshot () . lines_cleared ;
+  if ( idle_ticks )
+    engine . step ( NULL , 0 , idle_ticks ) ;
 
-  if ( game_state . paused || game_state . game_over )
-    goto CLEANUP ;
+  uint64_t tick_ns = monotonicNs () ;
+  InputEvent input [ BBT_EVENT_QUEUE_SIZE ] ;
+  int events [ BBT_EVENT_QUEUE_SIZE ] ;
+  unsigned int n_events = input_ring . drain ( input , BBT_EVENT_QUEUE_SIZE ) ;
 
-  ++tick_count ;
-  if ( !full_lines . empty () )
+  for ( unsigned int loop = 0 ; loop < n_events ; ++loop )
   {
-    processFullLines () ;
-    goto CLEANUP ;
+    events [ loop ] = input [ loop ] . event ;
+
+    // made up by the ring, no real input to follow
+    if ( input [ loop ] . time_ns == 0 )
+      continue ;
+
+    uint64_t input_ns = input [ loop ] . time_ns ;
+    if ( input [ loop ] . kernel_ns && input [ loop ] . kernel_ns <= input_ns )
+    {
+      latency_stats . kernel_to_enqueue . record ( input_ns - input [ loop ] . kernel_ns ) ;
+      input_ns = input [ loop ] . kernel_ns ;
+    }
+    latency_stats . enqueue_to_tick . record ( tick_ns - input [ loop ] . time_ns ) ;
+
+    if ( pending_input_ns == 0 )
+    {
+      pending_input_ns = input_ns ;
+      pending_tick_ns = tick_ns ;
+    }
   }
 
-  if ( tick_count % 2 == 0 && moving_down )
-    downTick();
-  if ( tick_count % 4 == 0 && moving_left )
-    game_state.active.tryMove(game_state.board, -1, 0, 0);
-  if ( tick_count % 4 == 0 && moving_right )
-    game_state.active.tryMove(game_state.board, 1, 0, 0);
-    
-  if ( tick_count > ticks_til_drop )
+  if ( journal . isOpen () )
   {
-    downTick () ;
-    tick_count = 0 ;
+    uint32_t tick = engine . getTick () ;
+    for ( unsigned int loop = 0 ; loop < n_events ; ++loop )
+    {
+      journal . record ( tick , events [ loop ] ) ;
+    }
+    // ticks can be skipped, so not every multiple comes up
+    if ( tick >= journal_flush_tick )
+    {
+      journal . flush () ;
+      journal_flush_tick = tick + JOURNAL_FLUSH_TICKS ;
+    }
+    countJournalLost () ;
   }
 
-CLEANUP:
-  pthread_mutex_unlock ( &output_lock ) ;
-  return result ;
+  engine . step ( events , n_events , n_ticks ) ;
+  publish () ;
+
+  const GameState& state = engine . snapshot () ;
+  stat_counters -> events_consumed . fetch_add ( n_events , std :: memory_order_relaxed ) ;
+  stat_counters -> events_dropped . store ( input_ring . getDropped () , std :: memory_order_relaxed ) ;
+  stat_counters -> pieces_locked . store ( engine . getPiecesLocked () , std :: memory_order_relaxed ) ;
+  stat_counters -> score . store ( state . score , std :: memory_order_relaxed ) ;
+  stat_counters -> level . store ( state . level , std :: memory_order_relaxed ) ;
+
+  // a new game starts over from 0
+  if ( state . lines_cleared > lines_before && state . lines_cleared - lines_before <= 4 )
+  {
+    unsigned int lines = state . lines_cleared - lines_before ;
+    stat_counters -> lines_cleared . fetch_add ( lines , std :: memory_order_relaxed ) ;
+    stat_counters -> line_clears [ lines - 1 ] . fetch_add ( 1 , std :: memory_order_relaxed ) ;
+  }
+  return true ;
 }
 
 
@@ -382,47 +421,207 @@ void* GameController :: periodicFunc ( void* in_thread_obj )
 
 
 
+///////////////////////////////////////////////////////////////////////////////
+/// \brief count one tick in latency_stats and stat_counters: how late it woke up after its
+///   deadline, how long processTick ran, and how many deadlines passed
+///   before it without a tick of their own. Lock free, safe from the RT
+///   thread
+///
+void GameController :: recordTick ( uint64_t late_ns , uint64_t run_ns , unsigned long missed )
+{
+  latency_stats . tick_late . record ( late_ns ) ;
+  latency_stats . tick_run . record ( run_ns ) ;
+  latency_stats . ticks . fetch_add ( 1 , std :: memory_order_relaxed ) ;
+  stat_counters -> ticks . fetch_add ( 1 , std :: memory_order_relaxed ) ;
+  stat_counters -> tick_run_ns . fetch_add ( run_ns , std :: memory_order_relaxed ) ;
+  if ( missed )
+  {
+    latency_stats . overrun_ticks . fetch_add ( 1 , std :: memory_order_relaxed ) ;
+    latency_stats . missed_periods . fetch_add ( missed , std :: memory_order_relaxed ) ;
+    stat_counters -> missed_periods . fetch_add ( missed , std :: memory_order_relaxed ) ;
+  }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief add the journal records dropped since the last call to
+///   stat_counters. Only from the thread that records
+///
+void GameController :: countJournalLost ()
+{
+  uint32_t lost = journal . getLost () ;
+  if ( lost != journal_lost )
+  {
+    stat_counters -> journal_lost . fetch_add ( lost - journal_lost , std :: memory_order_relaxed ) ;
+    journal_lost = lost ;
+  }
+}
+
+
+
 #ifdef NOXENOMAI
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief thread loop for systems without periodic timers. Calls periodicFunc
-///  and waits 16.66 milliseconds
-/// \return will never return
+///  each time the tick timer reaches a deadline, the same way the xenomai
+///  loop does with rt_task_wait_period
+/// \return NULL once stopped
 ///
 void* GameController :: threadFunc ( void* in_thread_obj )
 {
-  while ( 1 )
+  GameController* object = ( GameController* ) in_thread_obj ;
+  if ( object -> tickless )
+    return ticklessFunc ( in_thread_obj ) ;
+
+  NanosleepTimer default_timer ;
+  TickTimer* timer = object -> timer ? object -> timer : &default_timer ;
+
+  if ( !timer -> start ( BBT_TICK_PERIOD_NS ) )
   {
+    rt_printf ( "GameController: tick timer failed, using clock_nanosleep\n" ) ;
+    timer = &default_timer ;
+    timer -> start ( BBT_TICK_PERIOD_NS ) ;
+  }
+  unsigned long missed = timer -> wait () ;
+
+  while ( object -> running . load () )
+  {
+    uint64_t wake = monotonicNs () ;
     GameController :: periodicFunc ( in_thread_obj ) ;
-    usleep ( 16666 ) ;
+    uint64_t done = monotonicNs () ;
+    object -> recordTick ( wake - timer -> getDeadline () , done - wake , missed ) ;
+
+    missed = timer -> wait () ;
   }
 
   return NULL ;
 }
 
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief thread loop that only wakes up when something can change: when
+///  input is queued, or at the tick engine . ticksUntilChange says is next.
+///  Tick t is still due t periods after the start, so the engine runs the
+///  ticks slept through in one go on waking and plays the same game as the
+///  periodic loop would. Input is journaled and applied right after the
+///  last tick due, where the periodic loop would have applied it at the
+///  next one. Nothing is due while paused, so the thread then waits for
+///  input alone
+/// \return NULL once stopped
+///
+void* GameController :: ticklessFunc ( void* in_thread_obj )
+{
+  GameController* object = ( GameController* ) in_thread_obj ;
+  GameEngine& engine = object -> engine ;
+
+  int input_fd = object -> input_ring . enableNotify () ;
+  int timer_fd = timerfd_create ( CLOCK_MONOTONIC , TFD_CLOEXEC ) ;
+  if ( input_fd < 0 || timer_fd < 0 )
+  {
+    rt_printf ( "GameController: no eventfd or timerfd, ticking every period\n" ) ;
+    if ( timer_fd >= 0 )
+      close ( timer_fd ) ;
+    object -> tickless = false ;
+    return threadFunc ( in_thread_obj ) ;
+  }
+
+  // when tick 0 was due, so the next one is a period from now
+  uint64_t epoch = monotonicNs () - ( uint64_t ) engine . getTick () * BBT_TICK_PERIOD_NS ;
+  uint64_t deadline = 0 ;
+  pollfd fds [ 2 ] = { { input_fd , POLLIN , 0 } , { timer_fd , POLLIN , 0 } } ;
+  uint64_t count ;
+  ssize_t got = 0 ;
+
+  while ( object -> running . load () )
+  {
+    // both are read before the ring is drained, so nothing is missed
+    if ( poll ( fds , 2 , -1 ) < 0 )
+      continue ;
+    if ( !object -> running . load () )
+      break ;
+    uint64_t wake = monotonicNs () ;
+    if ( fds [ 0 ] . revents & POLLIN )
+      got = read ( input_fd , &count , sizeof ( count ) ) ;
+    if ( fds [ 1 ] . revents & POLLIN )
+      got = read ( timer_fd , &count , sizeof ( count ) ) ;
+    ( void ) got ;
+
+    uint32_t due = ( wake - epoch ) / BBT_TICK_PERIOD_NS ;
+    object -> processTick ( due - engine . getTick () , 0 ) ;
+    uint64_t done = monotonicNs () ;
+
+    if ( deadline && wake >= deadline )
+    {
+      object -> recordTick ( wake - deadline , done - wake
+                           , ( wake - deadline ) / BBT_TICK_PERIOD_NS ) ;
+    }
+
+    itimerspec next ;
+    memset ( &next , 0 , sizeof ( next ) ) ;
+    unsigned int ticks = engine . ticksUntilChange () ;
+    if ( ticks )
+    {
+      deadline = epoch + ( uint64_t ) ( engine . getTick () + ticks ) * BBT_TICK_PERIOD_NS ;
+      next . it_value . tv_sec = deadline / 1000000000ULL ;
+      next . it_value . tv_nsec = deadline % 1000000000ULL ;
+    }
+    else
+    {
+      // idle until input, keep what is journaled so far safe meanwhile
+      deadline = 0 ;
+      if ( object -> journal . isOpen () )
+        object -> journal . flush () ;
+    }
+    timerfd_settime ( timer_fd , TFD_TIMER_ABSTIME , &next , NULL ) ;
+  }
+
+  // the journal ends at the tick due now, as the periodic loop's does
+  uint32_t due = ( monotonicNs () - epoch ) / BBT_TICK_PERIOD_NS ;
+  engine . step ( NULL , 0 , due - engine . getTick () ) ;
+  close ( timer_fd ) ;
+  return NULL ;
+}
+
 #else
 
 ///////////////////////////////////////////////////////////////////////////////
 /// \brief thread loop for systems using xenomai. establishes a 16 ms timer
-///  and Calls periodicFunc each loop
-/// \return will never return
+///  and Calls periodicFunc each loop. Times come from the Xenomai timer, so
+///  measuring never leaves primary mode. Returns once stopped
 ///
 void GameController :: threadFunc ( void* in_thread_obj )
 {
-  int result = rt_task_set_periodic ( NULL , TM_NOW , 16666666 ) ;
-  //if ( result != 0 )
+  GameController* object = ( GameController* ) in_thread_obj ;
+
+  // first release a period from now, so every deadline is known
+  RTIME deadline = rt_timer_read () + BBT_TICK_PERIOD_NS ;
+  int result = rt_task_set_periodic ( NULL , deadline , BBT_TICK_PERIOD_NS ) ;
+  if ( result != 0 )
   {
     rt_printf ( "make periodic result = %d\n" , result ) ;
   }
   long unsigned overruns = 0 ;
+  rt_task_wait_period ( &overruns ) ;
+  deadline += overruns * BBT_TICK_PERIOD_NS ;
+  RTIME wake = rt_timer_read () ;
   
-  while ( 1 )
+  while ( object -> running . load () )
   {
     GameController :: periodicFunc ( in_thread_obj ) ;
+    RTIME done = rt_timer_read () ;
+    object -> recordTick ( wake - deadline , done - wake , overruns ) ;
+
+    // -ETIMEDOUT: overruns release points passed, returns at once for the
+    // latest of them
+    overruns = 0 ;
     result = rt_task_wait_period ( &overruns ) ;
-    if ( result != 0 )
+    if ( result != 0 && result != -ETIMEDOUT )
     {
-//      rt_printf ( "pthread_wait_np result = %d\n" , result ) ;
+      rt_printf ( "rt_task_wait_period result = %d\n" , result ) ;
     }
+    deadline += ( 1 + overruns ) * BBT_TICK_PERIOD_NS ;
+    wake = rt_timer_read () ;
   }
 }
 
@@ -7,51 +7,91 @@
 
 
 // external includes
-#include <mqueue.h>
-#include <vector>
+#include <pthread.h>
+#include <atomic>
+#ifndef NOXENOMAI
+#include <native/task.h>
+#endif
+#include <cstdint>
 
 // local includes
 #include "BBTdefines.hpp"
+#include "EventRing.hpp"
+#include "GameDelta.hpp"
+#include "GameEngine.hpp"
 #include "GameState.hpp"
+#include "Journal.hpp"
+#include "SpscRing.hpp"
+#include "TripleBuffer.hpp"
 
+class TickTimer ;
+
+///////////////////////////////////////////////////////////////////////////////
+/// \class accepts input from the input handler through an EventRing and runs
+/// the GameEngine from
+/// a periodic RT thread. It allows the display handler to pull game board
+/// data from this class. Every tick's state is published through a triple
+/// buffer, and what changed in it through a ring of GameDelta records, so the
+/// RT thread never waits for the display.
+///
+/// Without xenomai the thread can also run tickless: it sleeps until input
+/// arrives or the engine's next change is due, applies input at once, and
+/// does not wake at all while the game is paused or over.
 ///////////////////////////////////////////////////////////////////////////////
-/// \class accepts input from the input handler and manages changes to the 
-/// game board. It allows the display handler to pull game board data from 
-/// this class.  ///////////////////////////////////////////////////////////////////////////////
 class GameController
 {
 public :
     GameController () ;
     ~GameController () ;
   void start () ;
+  void stop () ;
+  void setPieceMode ( PieceGenerator :: Mode mode ) ;
+  bool startJournal ( const char* filename ) ;
+  EventRing& getInputRing () ;
   
   bool getGameState ( GameState &out_state ) ;
+  const GameDelta* peekDelta () const ;
+  void popDelta () ;
+  uint64_t getPublishTime () const ;
+  int getPublishFd () const ;
+  #ifdef NOXENOMAI
+  void setTimer ( TickTimer* tick_timer ) ;
+  bool setTickless () ;
+  #endif
   
 
 private :
-  void reset () ; 
-  int getFullLines () ;
-  bool processFullLines () ;
-  bool removeFullLines () ;
-  
   pthread_t thread ;
-  pthread_mutex_t output_lock ;
-  mqd_t input_queue ;
-                    
-  struct GameState game_state ;
-  unsigned int ticks_til_drop ;
-  unsigned int tick_count ;
-  std :: vector < unsigned int > full_lines ;
-  
-  bool moving_down, moving_left, moving_right;
-  
-  bool pause () ;
-  bool downTick () ;
-  bool processEvent ( int event ) ;
-  bool processTick () ;
+  #ifndef NOXENOMAI
+  RT_TASK task ;
+  #endif
+  std :: atomic < bool > running ;
+  EventRing input_ring ;
+  uint64_t pending_input_ns ;
+  uint64_t pending_tick_ns ;
+  TripleBuffer < GameState > frames ;
+  SpscRing < GameDelta , BBT_DELTA_RING_SIZE > deltas ;
+  std :: atomic < uint64_t > publish_ns ;
+  int publish_fd ;
+
+  GameEngine engine ;
+  uint64_t seed ;
+  JournalWriter journal ;
+  uint32_t journal_flush_tick ;
+  uint32_t journal_lost ;         // dropped records already counted
+  #ifdef NOXENOMAI
+  TickTimer* timer ;
+  bool tickless ;
+  #endif
+
+  void publish () ;
+  bool processTick ( unsigned int idle_ticks = 0 , unsigned int n_ticks = 1 ) ;
+  void recordTick ( uint64_t late_ns , uint64_t run_ns , unsigned long missed ) ;
+  void countJournalLost () ;
   static void* periodicFunc ( void* in_thread_obj ) ;
   #ifdef NOXENOMAI
   static void* threadFunc ( void* in_thread_obj ) ;
+  static void* ticklessFunc ( void* in_thread_obj ) ;
   #else
   static void threadFunc ( void* in_thread_obj ) ;
   #endif
@@ -0,0 +1,48 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the GameDelta record: what changed in the game since the
+/// previous record, so the display can update only the cells that changed
+/// instead of diffing the whole board every frame.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GAME_DELTA_H
+#define GAME_DELTA_H
+
+#include <cstdint>
+#include "BBTdefines.hpp"
+#include "Tetromino.hpp"
+
+struct CellChange {
+  int8_t x, y;
+  BlockData block;
+};
+
+// Everything the display draws apart from the board cells. Starts out as a
+// new game that has not been unpaused yet.
+struct GameStatus {
+  Tetromino next;
+  unsigned int score;
+  unsigned int level;
+  bool paused;
+  bool game_over;
+
+  GameStatus() : score(0), level(1), paused(true), game_over(false) {}
+};
+
+class GameDelta {
+public:
+  // Enough for flashing four full lines plus a piece locking. Clearing lines
+  // or starting a new game changes more and is sent as a resync instead.
+  static const unsigned int max_changes = 4 * BOARD_WIDTH + Tetromino::num_cells;
+
+  uint32_t tick;        // engine tick this record brings the reader up to
+  uint32_t seq;         // one more than the previous record, even in the same tick
+  bool resync;          // too much changed, reread the whole state
+  uint64_t input_ns;    // earliest input consumed since the last record, 0 if none
+  uint64_t tick_ns;     // when the tick that consumed it ran
+  GameStatus status;
+  Tetromino active;
+  unsigned int n_changes;
+  CellChange changes[max_changes];
+};
+
+#endif
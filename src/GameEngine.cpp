@@ -0,0 +1,388 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file implement the GameEngine class
+///////////////////////////////////////////////////////////////////////////////
+
+// this module's h file.
+#include "GameEngine.hpp"
+
+// local includes
+#include "BBTdefines.hpp"
+
+// defines
+#define TICKS_TIL_DROP_MAX 100
+#define TICKS_TIL_DROP_MIN 1
+#define FULL_LINE_COLOR_MAX 7
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief
+///
+GameEngine :: GameEngine ( uint64_t seed )
+  : pieces_locked ( 0 )
+{
+  reset ( seed ) ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief reset - initializes the game board for a new game and restarts the
+///   tick count. Everything that follows is fully determined by the seed and
+///   the events passed to step
+///
+void GameEngine :: reset ( uint64_t seed )
+{
+  tick_number = 0 ;
+  game_state . tick = 0 ;
+  newGame ( seed ) ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief initializes the game board for a new game
+///
+void GameEngine :: newGame ( uint64_t seed )
+{
+  ticks_til_drop = TICKS_TIL_DROP_MAX ;
+  tick_count = 0 ;
+  n_full_lines = 0 ;
+  moving_down = moving_left = moving_right = false ;
+  game_state . reset ( seed ) ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief choose independent random pieces or 7-bag sequences. Takes effect
+///   from the next piece and is kept across resets
+///
+void GameEngine :: setPieceMode ( PieceGenerator :: Mode mode )
+{
+  game_state . generator . setMode ( mode ) ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief lower the current block one square. If it is at an end, load the next
+///   block
+/// \return true on success
+///
+bool GameEngine :: downTick ()
+{
+  //if the current block is the lowest it can be, load next
+  if(!game_state.active.tryMove(game_state.board, 0, -1, 0) )
+  {
+    RowSet touched = game_state.active.place(game_state.board);
+    ++pieces_locked ;
+    game_state.active = game_state.next;
+    game_state.next.reinitialize(game_state.generator);
+
+    // If new block already intersects at the top of the board, game over
+    if (game_state.active.wouldIntersect(game_state.board, 0, 0, 0))
+    {
+      game_state . game_over = true ;
+    }
+
+    int lines = getFullLines ( touched ) ;
+    
+    game_state . lines_cleared += lines ;
+    game_state . level = game_state . lines_cleared / 10 + 1 ;
+    ticks_til_drop = TICKS_TIL_DROP_MAX - ( game_state . level * 5 ) ;
+    if ( ticks_til_drop > TICKS_TIL_DROP_MAX ) // overflow
+      ticks_til_drop = 0 ;
+    
+    game_state.score += lines * lines * 10 ;
+    game_state.score++ ; // one point for each block dropped
+  }
+  return true ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief determine if any lines are full. Only rows in candidates can have
+///   become full since the last check
+/// \return the number of full lines
+///
+int GameEngine :: getFullLines ( RowSet candidates )
+{
+  n_full_lines = game_state . board . findFullRows ( full_lines . data () , candidates ) ;
+  return n_full_lines ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief blink the full lines and then remove if count has passed.
+/// \return true on success
+///
+bool GameEngine :: processFullLines ()
+{ 
+  if ( tick_count >= FULL_LINE_COLOR_MAX )
+  {
+    return removeFullLines () ;
+  }
+  
+  for ( unsigned int loop = 0 ; loop < n_full_lines ; ++loop )
+  {
+    int y = full_lines [ loop ] ;
+    for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
+    {
+      BlockData block = game_state . board . get ( x , y ) ;
+      block . color = tick_count ;
+      game_state . board . set ( x , y , block ) ;
+    }
+  }
+  return true ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief remove the full lines and drop the remaining lines
+/// \return true on success
+///
+bool GameEngine :: removeFullLines ()
+{
+  game_state . board . removeRows ( full_lines . data () , n_full_lines ) ;
+  n_full_lines = 0 ;
+  tick_count = 0 ;
+  return true ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief toggle pause state
+/// \return true on success
+///
+bool GameEngine :: pause ()
+{
+  game_state . paused = !game_state . paused ;
+  if ( game_state . game_over )
+  {
+    // next game continues the same random sequence
+    newGame ( game_state . generator . nextSeed () ) ;
+  }
+  return true ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief move the current block based on the input event.
+/// \return true on success
+///
+bool GameEngine :: processEvent ( int event )
+{
+  switch ( event )
+  {
+    case EV_PAUSE :
+      moving_down = moving_left = moving_right = false;
+      return pause () ;
+      break ;
+    case EV_START_LEFT :
+      moving_left = true ;
+      break ;
+    case EV_STOP_LEFT :
+      moving_left = false ;
+      break ;
+    case EV_START_RIGHT :
+      moving_right = true ;
+      break ;
+    case EV_STOP_RIGHT :
+      moving_right = false ;
+      break ;
+    case EV_ROT_LEFT :
+      if ( !game_state . paused )
+        game_state.active.tryMove(game_state.board, 0, 0, -1);
+      break ;
+    case EV_ROT_RIGHT :
+      if ( !game_state . paused )
+        game_state.active.tryMove(game_state.board, 0, 0, 1);
+      break ;
+    case EV_START_DOWN :
+      moving_down = true ;
+      break ; 
+    case EV_STOP_DOWN :
+      moving_down = false ;
+      break ;
+    default :
+      break ;
+  }
+  return false ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief advance the game by one tick (1/60 s)
+/// \return true on success
+///
+bool GameEngine :: processTick ()
+{
+  if ( game_state . paused || game_state . game_over )
+    return true ;
+
+  ++tick_count ;
+  if ( n_full_lines )
+  {
+    processFullLines () ;
+    return true ;
+  }
+
+  if ( tick_count % 2 == 0 && moving_down )
+    downTick();
+  if ( tick_count % 4 == 0 && moving_left )
+    game_state.active.tryMove(game_state.board, -1, 0, 0);
+  if ( tick_count % 4 == 0 && moving_right )
+    game_state.active.tryMove(game_state.board, 1, 0, 0);
+
+  if ( tick_count > ticks_til_drop )
+  {
+    downTick () ;
+    tick_count = 0 ;
+  }
+
+  return true ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief apply the events in order, then advance the game by n_ticks
+///
+void GameEngine :: step ( const int* events
+                        , unsigned int n_events
+                        , unsigned int n_ticks )
+{
+  for ( unsigned int loop = 0 ; loop < n_events ; ++loop )
+  {
+    processEvent ( events [ loop ] ) ;
+  }
+
+  for ( unsigned int loop = 0 ; loop < n_ticks ; ++loop )
+  {
+    processTick () ;
+  }
+  tick_number += n_ticks ;
+  game_state . tick = tick_number ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief the current game state. Only valid until the next call to step
+///
+const GameState& GameEngine :: snapshot () const
+{
+  return game_state ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief number of ticks run since the last reset
+///
+uint32_t GameEngine :: getTick () const
+{
+  return tick_number ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief how many ticks step can run before the game changes without new
+///   events: the next gravity drop, auto-repeated move or line clear
+///   animation step. Running fewer than that only advances tick counters, so
+///   a caller may skip waking up for them and catch up later with a single
+///   step
+/// \return 0 if nothing changes until the next event, i.e. while paused or
+///   after game over
+///
+unsigned int GameEngine :: ticksUntilChange () const
+{
+  if ( game_state . paused || game_state . game_over )
+    return 0 ;
+
+  if ( n_full_lines )
+    return 1 ;
+
+  unsigned int ticks = 1 ;
+  if ( tick_count < ticks_til_drop )
+    ticks = ticks_til_drop + 1 - tick_count ;
+
+  if ( moving_down )
+  {
+    unsigned int down = 2 - tick_count % 2 ;
+    if ( down < ticks )
+      ticks = down ;
+  }
+  if ( moving_left || moving_right )
+  {
+    unsigned int side = 4 - tick_count % 4 ;
+    if ( side < ticks )
+      ticks = side ;
+  }
+  return ticks ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief number of pieces that came to rest since the engine was created.
+///   Not reset with the game, so it only ever counts up
+///
+uint32_t GameEngine :: getPiecesLocked () const
+{
+  return pieces_locked ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief describe everything that changed since the previous call, then
+///   start collecting changes again. Changes from several steps are merged
+///   until they are taken. Every record gets the next sequence number, kept
+///   across reset so a reader never sees it go back. Input timing is left to
+///   the caller
+///
+void GameEngine :: takeDelta ( GameDelta &out_delta )
+{
+  out_delta . tick = tick_number ;
+  out_delta . seq = ++game_state . seq ;
+  out_delta . resync = false ;
+  out_delta . input_ns = out_delta . tick_ns = 0 ;
+  out_delta . n_changes = 0 ;
+
+  for ( int y = 0 ; y < BOARD_HEIGHT && !out_delta . resync ; ++y )
+  {
+    RowMask dirty = game_state . board . getDirty ( y ) ;
+    for ( int x = 0 ; dirty ; ++x , dirty >>= 1 )
+    {
+      if ( !( dirty & 1 ) )
+        continue ;
+
+      if ( out_delta . n_changes == GameDelta :: max_changes )
+      {
+        out_delta . resync = true ;
+        out_delta . n_changes = 0 ;
+        break ;
+      }
+
+      CellChange &change = out_delta . changes [ out_delta . n_changes++ ] ;
+      change . x = x ;
+      change . y = y ;
+      change . block = game_state . board . get ( x , y ) ;
+    }
+  }
+  game_state . board . clearDirty () ;
+
+  out_delta . active = game_state . active ;
+  out_delta . status . next = game_state . next ;
+  out_delta . status . score = game_state . score ;
+  out_delta . status . level = game_state . level ;
+  out_delta . status . paused = game_state . paused ;
+  out_delta . status . game_over = game_state . game_over ;
+}
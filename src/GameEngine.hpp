@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the GameEngine class
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TETRIS_GAME_ENGINE_H
+#define TETRIS_GAME_ENGINE_H 1
+
+
+// external includes
+#include <array>
+#include <cstdint>
+
+// local includes
+#include "BBTdefines.hpp"
+#include "GameDelta.hpp"
+#include "GameState.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+/// \class implements the game rules. Events and ticks are applied by step, and
+/// the resulting state is read back with snapshot. The engine performs no
+/// syscalls, locking or allocation so it can be driven by the RT controller
+/// thread as well as by tests, benchmarks and simulators.
+///////////////////////////////////////////////////////////////////////////////
+class GameEngine
+{
+public :
+    GameEngine ( uint64_t seed = 0 ) ;
+
+  void reset ( uint64_t seed ) ;
+  void setPieceMode ( PieceGenerator :: Mode mode ) ;
+  void step ( const int* events , unsigned int n_events , unsigned int n_ticks = 1 ) ;
+  const GameState& snapshot () const ;
+  void takeDelta ( GameDelta &out_delta ) ;
+  uint32_t getTick () const ;
+  unsigned int ticksUntilChange () const ;
+  uint32_t getPiecesLocked () const ;
+
+private :
+  void newGame ( uint64_t seed ) ;
+  int getFullLines ( RowSet candidates ) ;
+  bool processFullLines () ;
+  bool removeFullLines () ;
+
+  struct GameState game_state ;
+  uint32_t tick_number ;
+  uint32_t pieces_locked ;
+  unsigned int ticks_til_drop ;
+  unsigned int tick_count ;
+  std :: array < int , BOARD_HEIGHT > full_lines ;
+  unsigned int n_full_lines ;
+
+  bool moving_down, moving_left, moving_right;
+
+  bool pause () ;
+  bool downTick () ;
+  bool processEvent ( int event ) ;
+  bool processTick () ;
+} ;
+
+
+#endif // TETRIS_GAME_ENGINE_H
+
@@ -2,33 +2,41 @@
 #define GAME_STATE_H
 
 #include "BBTdefines.hpp"
+#include <cstdint>
+#include "BoardState.hpp"
+#include "PieceGenerator.hpp"
 #include "Tetromino.hpp"
 
 class GameState {
 public:
   BoardState board;
+  PieceGenerator generator;
   Tetromino active, next;
   unsigned int score;
   unsigned int level;
   unsigned int lines_cleared;
   bool paused ;
   bool game_over ;
+  uint32_t tick ;  // engine tick this state was taken at
+  uint32_t seq ;   // GameDelta::seq of the last record taken before it
 
-  GameState() { reset () ; }
-  
-  void reset ()
+  GameState() : tick ( 0 ) , seq ( 0 ) { reset ( 0 ) ; }
+
+  // Start a new game. The piece sequence is fully determined by the seed and
+  // the generator mode.
+  void reset ( uint64_t seed )
   {
     score = 0 ;
     level = 1 ;
     lines_cleared = 0 ;
     paused = true ;
     game_over = false ;
-    
-    for(unsigned int x = 0; x < board.size(); x++) {
-      for(unsigned int y = 0; y < board[x].size(); y++) {
-        board[x][y] = BlockData(0, 0);
-      }
-    }
+
+    board.clear();
+
+    generator.seed ( seed ) ;
+    active.reinitialize ( generator ) ;
+    next.reinitialize ( generator ) ;
   }
 };
 
@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the Histogram class: counts values into log-linear buckets
+/// so percentiles can be read at any time. Recording is one relaxed atomic
+/// increment, safe from any thread including the RT one, and never
+/// allocates. Each power of two is split into 16 buckets, so a reported
+/// percentile is at most about 6% above the true value.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <stdio.h>
+
+class Histogram {
+public:
+  static const int sub_bits = 4;
+  static const int n_buckets = 64 << sub_bits;
+
+  Histogram() { reset(); }
+
+  void record(uint64_t value) {
+    buckets[index(value)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void reset() {
+    for(int i = 0; i < n_buckets; i++) buckets[i].store(0, std::memory_order_relaxed);
+  }
+
+  uint64_t count() const {
+    uint64_t total = 0;
+    for(int i = 0; i < n_buckets; i++) total += buckets[i].load(std::memory_order_relaxed);
+    return total;
+  }
+
+  // Upper bound of the bucket holding the value below which a fraction p
+  // (0 to 1) of all recorded values fall. 0 if nothing was recorded.
+  uint64_t percentile(double p) const {
+    uint64_t total = count();
+    if(total == 0) return 0;
+
+    uint64_t rank = (uint64_t)(p * total + 0.5);
+    if(rank < 1) rank = 1;
+
+    uint64_t seen = 0;
+    for(int i = 0; i < n_buckets; i++) {
+      seen += buckets[i].load(std::memory_order_relaxed);
+      if(seen >= rank) return upperBound(i);
+    }
+    return upperBound(n_buckets - 1);
+  }
+
+  // One line of count and percentiles, with values in ns shown as us
+  void print(FILE * out, const char * name) const {
+    fprintf(out, "%-20s n=%-8llu p50=%9.1fus p90=%9.1fus p99=%9.1fus p99.9=%9.1fus max=%9.1fus\n",
+            name, (unsigned long long)count(),
+            percentile(0.50) / 1e3, percentile(0.90) / 1e3, percentile(0.99) / 1e3,
+            percentile(0.999) / 1e3, percentile(1.0) / 1e3);
+  }
+
+  // The same for values that are counts rather than times
+  void printCounts(FILE * out, const char * name) const {
+    fprintf(out, "%-20s n=%-8llu p50=%9llu   p90=%9llu   p99=%9llu   p99.9=%9llu   max=%9llu\n",
+            name, (unsigned long long)count(),
+            (unsigned long long)percentile(0.50), (unsigned long long)percentile(0.90),
+            (unsigned long long)percentile(0.99), (unsigned long long)percentile(0.999),
+            (unsigned long long)percentile(1.0));
+  }
+
+  // Every bucket that has values, one "name upper_bound count" line each,
+  // for plotting or comparing runs
+  void write(FILE * out, const char * name) const {
+    for(int i = 0; i < n_buckets; i++) {
+      uint32_t n = buckets[i].load(std::memory_order_relaxed);
+      if(n) fprintf(out, "%s %llu %u\n", name, (unsigned long long)upperBound(i), n);
+    }
+  }
+
+private:
+  // Values below 2^sub_bits get a bucket each, above that every power of two
+  // gets 2^sub_bits buckets
+  static int index(uint64_t value) {
+    if(value < (1u << sub_bits)) return (int)value;
+    int shift = 63 - __builtin_clzll(value) - sub_bits;
+    return (shift << sub_bits) + (int)(value >> shift);
+  }
+
+  static uint64_t upperBound(int i) {
+    if(i < (2 << sub_bits)) return i;
+    int shift = (i >> sub_bits) - 1;
+    uint64_t mantissa = i - (shift << sub_bits);
+    return ((mantissa + 1) << shift) - 1;
+  }
+
+  std::atomic<uint32_t> buckets[n_buckets];
+};
+
+#endif
@@ -17,21 +17,37 @@
 #include <glob.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
 
 //needed for sleep
 #include <unistd.h>
 
 // local includes
 #include "BBTdefines.hpp"
+#include "LatencyStats.hpp"
 
 // defines
 #define JOY_DEV "/dev/input/js0"
+#define BBT_INPUT_DIR "/dev/input"
+#define BBT_INPUT_MAX_DEVICES 16
+#define BBT_INPUT_READ_BATCH 64
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief default constructor, creates a message queue
+/// \brief constructor. Events go to ring, or if ring is NULL to a message
+///   queue created here
 ///
-InputHandler :: InputHandler ()
+InputHandler :: InputHandler ( EventRing* ring )
+  : out_ring ( ring )
+  , out_queue ( -1 )
+  , epoll_fd ( -1 )
+  , inotify_fd ( -1 )
 {
+  if ( out_ring )
+    return ;
+
   struct mq_attr attr ;   // To store queue attributes
 
   // First we need to set up the attribute structure
@@ -54,22 +70,15 @@ InputHandler :: InputHandler ()
 
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief check if an event file is of the correct type to open
+/// \brief check if an open event device is of the correct type to use
 ///
-bool isValidInputEventFile ( char* filename )
+static bool isValidInputDevice ( int fd , const char* filename )
 {
-  bool result = false ;
-  int fd = -1 ;
   char name [ 256 ] = "Unknown" ;
 
-  if ( ( fd = open ( filename , O_RDONLY ) ) < 0 ) {
-    perror("evdev open");
-    return false ; //exit(1);
-  }
-
   if ( ioctl ( fd , EVIOCGNAME ( sizeof ( name ) ) , name ) < 0) {
     rt_printf ( "evdev ioctl" ) ;
-    goto CLEANUP ;
+    return false ;
   }
 
   rt_printf ( "The device on %s says its name is %s\n"
@@ -82,21 +91,53 @@ bool isValidInputEventFile ( char* filename )
       )
   {
     rt_printf ( "using device%s\n" , filename ) ;
-    result = true ;
+    return true ;
   }
-
-CLEANUP:
-  close ( fd ) ;
-  return result ;
+  return false ;
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief starts the processing thread and sets priority to max
+/// \brief opens the devices already present and starts the processing thread
+///   with its priority set to max
 ///
 void InputHandler :: start ()
 {
+  epoll_fd = epoll_create ( BBT_INPUT_MAX_DEVICES ) ;
+  if ( epoll_fd < 0 )
+  {
+    rt_printf ( "InputHandler: epoll_create failed %d\n" , errno ) ;
+    return ;
+  }
+
+  // watch for devices coming and going before looking for the current ones,
+  // so none can be missed in between
+  inotify_fd = inotify_init1 ( IN_NONBLOCK ) ;
+  if ( inotify_fd < 0
+    || inotify_add_watch ( inotify_fd , BBT_INPUT_DIR , IN_CREATE | IN_ATTRIB | IN_DELETE ) < 0 )
+  {
+    rt_printf ( "InputHandler: no hotplug, inotify failed %d\n" , errno ) ;
+  }
+  else
+  {
+    epoll_event watch ;
+    memset ( &watch , 0 , sizeof ( watch ) ) ;
+    watch . events = EPOLLIN ;
+    watch . data . fd = inotify_fd ;
+    epoll_ctl ( epoll_fd , EPOLL_CTL_ADD , inotify_fd , &watch ) ;
+  }
+
+  glob_t globbuf ;
+  glob ( BBT_INPUT_DIR "/event*" , GLOB_TILDE , NULL , &globbuf ) ;
+  printf ( "number of events found %d\n" , ( int ) globbuf . gl_pathc ) ;
+
+  for ( unsigned int loop = 0 ; loop < globbuf . gl_pathc ; ++loop )
+  {
+    addDevice ( globbuf . gl_pathv [ loop ] ) ;
+  }
+  globfree ( &globbuf ) ;
+
   pthread_attr_t attr ;
   pthread_attr_init ( &attr ) ;
   int policy = 0 ;
@@ -105,29 +146,164 @@ void InputHandler :: start ()
   pthread_attr_getschedpolicy ( &attr , &policy ) ;
   max_prio_for_policy = sched_get_priority_max ( policy ) ;
 
-  glob_t globbuf ;
-  glob ( "/dev/input/event*" , GLOB_TILDE , NULL , &globbuf ) ;
-  printf ( "number of events found %d\n" , ( int ) globbuf . gl_pathc ) ;
+  rt_printf ( "InputHandler starting thread\n" ) ;
+  pthread_create ( &thread , &attr ,  ( void* (*) ( void*) ) ( thread_func ) , this ) ;
+  pthread_setschedprio ( thread , max_prio_for_policy ) ;
+  pthread_attr_destroy ( &attr ) ;
+}
 
-  for ( unsigned int loop = 0 ; loop < globbuf . gl_pathc ; ++loop )
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief open a device and add it to the epoll set if it is one we use
+/// \return true if the device was added
+///
+bool InputHandler :: addDevice ( const std :: string &filename )
+{
+  for ( std :: map < int , Device > :: iterator it = devices . begin () ; it != devices . end () ; ++it )
+  {
+    if ( it -> second . filename == filename )
+      return false ;
+  }
+
+  int fd = open ( filename . c_str () , O_RDONLY | O_NONBLOCK ) ;
+  if ( fd < 0 )
+  {
+    perror ( "evdev open" ) ;
+    return false ;
+  }
+
+  if ( !isValidInputDevice ( fd , filename . c_str () ) )
+  {
+    close ( fd ) ;
+    return false ;
+  }
+
+  // event timestamps on the same clock as the rest of the latency stats.
+  // Older kernels stay on CLOCK_REALTIME, their timestamps are not used
+  Device device ;
+  device . filename = filename ;
+  device . monotonic = false ;
+#ifdef EVIOCSCLOCKID
+  int clock_id = CLOCK_MONOTONIC ;
+  device . monotonic = ioctl ( fd , EVIOCSCLOCKID , &clock_id ) == 0 ;
+#endif
+  if ( !device . monotonic )
   {
-    if ( isValidInputEventFile ( globbuf . gl_pathv [ loop ] ) )
+    rt_printf ( "InputHandler: no monotonic timestamps from %s\n" , filename . c_str () ) ;
+  }
+
+  epoll_event watch ;
+  memset ( &watch , 0 , sizeof ( watch ) ) ;
+  watch . events = EPOLLIN ;
+  watch . data . fd = fd ;
+  if ( epoll_ctl ( epoll_fd , EPOLL_CTL_ADD , fd , &watch ) < 0 )
+  {
+    rt_printf ( "InputHandler: epoll_ctl failed for %s\n" , filename . c_str () ) ;
+    close ( fd ) ;
+    return false ;
+  }
+
+  devices [ fd ] = device ;
+  return true ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief stop listening to a device, after it was unplugged
+///
+void InputHandler :: removeDevice ( int fd )
+{
+  std :: map < int , Device > :: iterator it = devices . find ( fd ) ;
+  if ( it == devices . end () )
+    return ;
+
+  rt_printf ( "InputHandler: removing device %s\n" , it -> second . filename . c_str () ) ;
+  epoll_ctl ( epoll_fd , EPOLL_CTL_DEL , fd , NULL ) ;
+  close ( fd ) ;
+  devices . erase ( it ) ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief process every event waiting on a device, several per read
+///
+void InputHandler :: readDevice ( int fd )
+{
+  std :: map < int , Device > :: iterator it = devices . find ( fd ) ;
+  if ( it == devices . end () )
+    return ;
+  bool monotonic = it -> second . monotonic ;
+
+  input_event events [ BBT_INPUT_READ_BATCH ] ;
+  while ( 1 )
+  {
+    ssize_t rb = read ( fd , events , sizeof ( events ) ) ;
+    if ( rb < 0 )
     {
-      std :: string *filename = new std :: string ( globbuf . gl_pathv [ loop ] ) ;   
-      rt_printf ( "InputHandler starting thread: %s\n" , filename -> c_str () ) ;
+      // ENODEV once the device is unplugged
+      if ( errno != EAGAIN && errno != EINTR )
+        removeDevice ( fd ) ;
+      return ;
+    }
 
-      pthread_create ( &thread , NULL ,  ( void* (*) ( void*) ) ( thread_func ) , filename ) ;
-      pthread_setschedprio ( thread , max_prio_for_policy ) ;
-      pthread_attr_destroy ( &attr ) ;
+    int n_events = rb / sizeof ( input_event ) ;
+    for ( int loop = 0 ; loop < n_events ; ++loop )
+    {
+      processEvent ( events [ loop ] , monotonic ) ;
     }
+
+    if ( n_events < BBT_INPUT_READ_BATCH )
+      return ;
   }
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief static thread function passed to pthread. opens the device and 
-///  attempts to process inputs from it.
+/// \brief pick up devices created in or deleted from the input directory.
+///   Permissions may only be set after creation, so attribute changes are
+///   another chance to open a new device
+///
+void InputHandler :: readHotplug ()
+{
+  char buffer [ 4096 ] __attribute__ ( ( aligned ( __alignof__ ( inotify_event ) ) ) ) ;
+
+  ssize_t length ;
+  while ( ( length = read ( inotify_fd , buffer , sizeof ( buffer ) ) ) > 0 )
+  {
+    for ( char* ptr = buffer ; ptr < buffer + length ; ptr += sizeof ( inotify_event ) + ( ( inotify_event* ) ptr ) -> len )
+    {
+      const inotify_event* event = ( const inotify_event* ) ptr ;
+      if ( event -> len == 0 || strncmp ( event -> name , "event" , 5 ) != 0 )
+        continue ;
+
+      std :: string filename = std :: string ( BBT_INPUT_DIR "/" ) + event -> name ;
+      if ( event -> mask & ( IN_CREATE | IN_ATTRIB ) )
+      {
+        addDevice ( filename ) ;
+      }
+      else if ( event -> mask & IN_DELETE )
+      {
+        for ( std :: map < int , Device > :: iterator it = devices . begin () ; it != devices . end () ; ++it )
+        {
+          if ( it -> second . filename == filename )
+          {
+            removeDevice ( it -> first ) ;
+            break ;
+          }
+        }
+      }
+    }
+  }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief static thread function passed to pthread.
 ///
 void* InputHandler :: thread_func ( void* in_ptr )
 {
@@ -137,42 +313,44 @@ void* InputHandler :: thread_func ( void* in_ptr )
     return NULL ;
   }
 
-  std :: string *filename = ( std :: string* ) in_ptr ;
-  int fd = -1 ;
-
-  if ( ( fd = open ( filename -> c_str () , O_RDONLY ) ) < 0 ) {
-    perror("evdev open");
-    return NULL ; //exit(1);
-  }
+  return ( ( InputHandler* ) in_ptr ) -> exec () ;
+}
 
-  mqd_t output = mq_open ( BBT_EVENT_QUEUE_NAME
-                      , O_WRONLY ) ;
 
-  if ( output < 0 )
-  {
-    rt_printf ( "InputHandler: failed to open queue" ) ;
-  }
 
-  struct input_event ev;
+///////////////////////////////////////////////////////////////////////////////
+/// \brief waits for input on all devices and for hotplug events
+/// \return will never return
+///
+void* InputHandler :: exec ()
+{
+  epoll_event ready [ BBT_INPUT_MAX_DEVICES ] ;
   while ( 1 )
   {
-    size_t rb = read ( fd , &ev , sizeof ( struct input_event ) ) ;
-    if ( rb > 0 )
-      processEvent ( ev , output ) ;
+    int n_ready = epoll_wait ( epoll_fd , ready , BBT_INPUT_MAX_DEVICES , -1 ) ;
+    for ( int loop = 0 ; loop < n_ready ; ++loop )
+    {
+      int fd = ready [ loop ] . data . fd ;
+      if ( fd == inotify_fd )
+        readHotplug () ;
+      else if ( ready [ loop ] . events & ( EPOLLERR | EPOLLHUP ) )
+        removeDevice ( fd ) ;
+      else
+        readDevice ( fd ) ;
+    }
   }
 
-  mq_close ( output ) ;
-  close ( fd ) ;
   return NULL ;
 }
 
 
 
 ///////////////////////////////////////////////////////////////////////////////
-/// \brief parse the event and pass messages to the next thread
+/// \brief parse the event and pass messages to the next thread. The event
+///   time is passed along if it is on CLOCK_MONOTONIC
 /// \return 0 on success, 1 on ignore, negative for error
 ///
-int InputHandler :: processEvent ( const input_event &e , mqd_t output )
+int InputHandler :: processEvent ( const input_event &e , bool monotonic )
 {
   if ( (e . type & EV_KEY) && (e.value == 0 || e.value == 1) )
   {
@@ -219,9 +397,32 @@ int InputHandler :: processEvent ( const input_event &e , mqd_t output )
     }
     if ( msg != EV_NONE )
     {
-      mq_send ( output , ( char* ) &msg , sizeof ( msg ) , 0 ) ;
+#ifdef input_event_sec
+      uint64_t kernel_ns = ( uint64_t ) e . input_event_sec * 1000000000ULL + e . input_event_usec * 1000ULL ;
+#else
+      uint64_t kernel_ns = ( uint64_t ) e . time . tv_sec * 1000000000ULL + e . time . tv_usec * 1000ULL ;
+#endif
+      deliver ( msg , monotonic ? kernel_ns : 0 ) ;
       return 0 ;
     }   
   }
   return 1 ;
 }
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief pass a message to the next thread. Never blocks when using the
+///   ring; if it is full the ring deals with the dropped message
+///
+void InputHandler :: deliver ( int msg , uint64_t kernel_ns )
+{
+  if ( out_ring )
+  {
+    out_ring -> push ( msg , monotonicNs () , kernel_ns ) ;
+  }
+  else
+  {
+    mq_send ( out_queue , ( char* ) &msg , sizeof ( msg ) , 0 ) ;
+  }
+}
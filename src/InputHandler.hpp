@@ -10,28 +10,56 @@
 #include <mqueue.h>
 #include <linux/joystick.h>
 #include <linux/input.h>
+#include <pthread.h>
+#include <map>
 #include <string>
 
+// local includes
+#include "EventRing.hpp"
+
 ///////////////////////////////////////////////////////////////////////////////
 /// \class handles input from keyboards and joysticks. Filters the expected events
-/// into the event enumerations expected by the tetris game logic
+/// into the event enumerations expected by the tetris game logic, and pushes
+/// them to an EventRing. Without a ring they are sent to the posix queue
+/// BBT_EVENT_QUEUE_NAME instead, for tools running in another process.
+///
+/// A single thread waits on all devices with epoll and reads their events in
+/// batches. /dev/input is watched with inotify so that devices can be plugged
+/// in and removed while running.
 ///////////////////////////////////////////////////////////////////////////////
 class InputHandler
 {
 public :
-    InputHandler ( ) ;
+    InputHandler ( EventRing* ring = NULL ) ;
   void start () ;
   
 private :
+  struct Device
+  {
+    std :: string filename ;
+    bool monotonic ;  // event times are CLOCK_MONOTONIC
+  } ;
+
+  EventRing* out_ring ;
   mqd_t out_queue ;
   pthread_t thread ;
+  int epoll_fd ;
+  int inotify_fd ;
+  std :: map < int , Device > devices ;  // by file descriptor
   std :: string ps_dev_name ;
   std :: string keyboard_dev_name ;
 
-  static int processEvent ( const js_event &e , mqd_t output ) ;
-  static int processEvent ( const input_event &e , mqd_t output ) ;
+  bool addDevice ( const std :: string &filename ) ;
+  void removeDevice ( int fd ) ;
+  void readDevice ( int fd ) ;
+  void readHotplug () ;
+
+  int processEvent ( const js_event &e ) ;
+  int processEvent ( const input_event &e , bool monotonic ) ;
+  void deliver ( int msg , uint64_t kernel_ns ) ;
 
   static void* thread_func ( void* ) ;
+  void* exec () ;
 } ; 
 
 
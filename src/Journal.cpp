@@ -0,0 +1,412 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file implement the JournalWriter and JournalReader classes
+///////////////////////////////////////////////////////////////////////////////
+
+// this module's h file.
+#include "Journal.hpp"
+
+// external includes
+#include <string.h>
+#include <time.h>
+
+// local includes
+#include "GameEngine.hpp"
+
+// defines
+#define BBT_JOURNAL_HEADER_SIZE 16
+#define BBT_JOURNAL_FLAGS_OFFSET 6
+#define BBT_JOURNAL_MAX_VARINT 10
+
+static_assert ( EV_PAUSE < ( 1 << BBT_JOURNAL_EVENT_BITS )
+              , "bbtEvents no longer fit in a journal record" ) ;
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief with background false, flush writes from the calling thread
+///
+JournalWriter :: JournalWriter ( bool background )
+  : file ( NULL )
+  , last_tick ( 0 )
+  , lost ( 0 )
+  , background ( background )
+  , current ( NULL )
+  , writing ( false )
+  , write_failed ( false )
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief flushes but does not terminate the journal, so a replay stops at the
+///   last recorded event
+///
+JournalWriter :: ~JournalWriter ()
+{
+  if ( file )
+  {
+    flush () ;
+    stopWriter () ;
+    fclose ( file ) ;
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief create the journal file, write its header and start the writer
+///   thread. Ticks passed to record are counted from the game reset that
+///   used this seed
+/// \return true on success
+///
+bool JournalWriter :: open ( const char* filename
+                           , uint64_t seed
+                           , PieceGenerator :: Mode mode )
+{
+  file = fopen ( filename , "wb" ) ;
+  if ( file == NULL )
+  {
+    return false ;
+  }
+
+  unsigned char header [ BBT_JOURNAL_HEADER_SIZE ] ;
+  memset ( header , 0 , sizeof ( header ) ) ;
+  memcpy ( header , BBT_JOURNAL_MAGIC , 4 ) ;
+  header [ 4 ] = BBT_JOURNAL_VERSION ;
+  header [ 5 ] = ( unsigned char ) mode ;
+  for ( int loop = 0 ; loop < 8 ; ++loop )
+  {
+    header [ 8 + loop ] = ( unsigned char ) ( seed >> ( loop * 8 ) ) ;
+  }
+
+  last_tick = 0 ;
+  lost = 0 ;
+  current = NULL ;
+  write_failed . store ( fwrite ( header , sizeof ( header ) , 1 , file ) != 1 ) ;
+
+  if ( background )
+  {
+    writing . store ( true ) ;
+    if ( pthread_create ( &writer , NULL , writerFunc , this ) != 0 )
+    {
+      writing . store ( false ) ;
+      fclose ( file ) ;
+      file = NULL ;
+      return false ;
+    }
+  }
+  return !write_failed . load () ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief
+/// \return true if the journal is recording
+///
+bool JournalWriter :: isOpen () const
+{
+  return file != NULL ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief append an event consumed before the update of the given tick. No
+///   syscalls or locks. Dropped, and counted by getLost, if the writer is
+///   too far behind
+///
+void JournalWriter :: record ( uint32_t tick , int event )
+{
+  if ( file == NULL )
+    return ;
+
+  if ( current && current -> used + BBT_JOURNAL_MAX_VARINT > sizeof ( current -> data ) )
+  {
+    flush () ;
+  }
+  if ( current == NULL )
+  {
+    current = blocks . claim () ;
+    if ( current == NULL )
+    {
+      // the next record's delta still counts from the last one kept
+      ++lost ;
+      return ;
+    }
+    current -> used = 0 ;
+  }
+
+  uint64_t value = ( ( uint64_t ) ( tick - last_tick ) << BBT_JOURNAL_EVENT_BITS )
+                 | ( event & ( ( 1 << BBT_JOURNAL_EVENT_BITS ) - 1 ) ) ;
+  last_tick = tick ;
+
+  do
+  {
+    unsigned char byte = value & 0x7F ;
+    value >>= 7 ;
+    current -> data [ current -> used++ ] = byte | ( value ? 0x80 : 0 ) ;
+  } while ( value ) ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief hand all buffered records to the writer thread, which has them in
+///   the file within BBT_JOURNAL_WRITE_NS. Without one, write them out now
+///
+void JournalWriter :: flush ()
+{
+  if ( current && current -> used )
+  {
+    blocks . push () ;
+    current = NULL ;
+  }
+  if ( file && !background )
+    writeBlocks () ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief terminate the journal at final_tick, wait for everything to be
+///   written and close the file. Only once the recording thread is done.
+///   If records were dropped the header is marked lossy
+/// \return true on success, false if records were lost or a write failed
+///
+bool JournalWriter :: close ( uint32_t final_tick )
+{
+  if ( file == NULL )
+    return false ;
+
+  record ( final_tick , EV_NONE ) ;
+  flush () ;
+  stopWriter () ;
+  if ( lost )
+  {
+    if ( fseek ( file , BBT_JOURNAL_FLAGS_OFFSET , SEEK_SET ) != 0
+      || putc ( BBT_JOURNAL_FLAG_LOSSY , file ) == EOF )
+      write_failed . store ( true ) ;
+  }
+  bool result = !write_failed . load () && lost == 0 ;
+  result = fclose ( file ) == 0 && result ;
+  file = NULL ;
+  return result ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief records dropped because the writer thread was behind
+///
+uint32_t JournalWriter :: getLost () const
+{
+  return lost ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief
+/// \return true if writing the file failed at any point
+///
+bool JournalWriter :: hasWriteFailed () const
+{
+  return write_failed . load () ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief write out and release every handed over block
+///
+void JournalWriter :: writeBlocks ()
+{
+  const JournalBlock* block ;
+  bool wrote = false ;
+  while ( ( block = blocks . peek () ) != NULL )
+  {
+    if ( fwrite ( block -> data , block -> used , 1 , file ) != 1 )
+      write_failed . store ( true ) ;
+    blocks . pop () ;
+    wrote = true ;
+  }
+  if ( wrote && fflush ( file ) != 0 )
+    write_failed . store ( true ) ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief let the writer thread write what is left and wait for it
+///
+void JournalWriter :: stopWriter ()
+{
+  if ( writing . exchange ( false ) )
+    pthread_join ( writer , NULL ) ;
+  writeBlocks () ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief writer thread loop, a plain Linux thread
+/// \return NULL once stopped
+///
+void* JournalWriter :: writerFunc ( void* in_journal )
+{
+  JournalWriter* journal = ( JournalWriter* ) in_journal ;
+  timespec interval = { 0 , BBT_JOURNAL_WRITE_NS } ;
+
+  while ( journal -> writing . load () )
+  {
+    journal -> writeBlocks () ;
+    nanosleep ( &interval , NULL ) ;
+  }
+  return NULL ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief
+///
+JournalReader :: JournalReader ()
+  : file ( NULL )
+  , data_start ( 0 )
+  , seed ( 0 )
+  , mode ( PieceGenerator :: MODE_RANDOM )
+  , flags ( 0 )
+  , tick ( 0 )
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief
+///
+JournalReader :: ~JournalReader ()
+{
+  if ( file )
+    fclose ( file ) ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief open a journal and read its header
+/// \return true on success, false if missing or not a journal
+///
+bool JournalReader :: open ( const char* filename )
+{
+  file = fopen ( filename , "rb" ) ;
+  if ( file == NULL )
+  {
+    return false ;
+  }
+
+  unsigned char header [ BBT_JOURNAL_HEADER_SIZE ] ;
+  if ( fread ( header , sizeof ( header ) , 1 , file ) != 1
+    || memcmp ( header , BBT_JOURNAL_MAGIC , 4 ) != 0
+    || header [ 4 ] != BBT_JOURNAL_VERSION )
+  {
+    fclose ( file ) ;
+    file = NULL ;
+    return false ;
+  }
+
+  mode = ( PieceGenerator :: Mode ) header [ 5 ] ;
+  flags = header [ BBT_JOURNAL_FLAGS_OFFSET ] ;
+  seed = 0 ;
+  for ( int loop = 0 ; loop < 8 ; ++loop )
+  {
+    seed |= ( uint64_t ) header [ 8 + loop ] << ( loop * 8 ) ;
+  }
+
+  data_start = ftell ( file ) ;
+  tick = 0 ;
+  return true ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief
+///
+uint64_t JournalReader :: getSeed () const
+{
+  return seed ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief
+///
+PieceGenerator :: Mode JournalReader :: getMode () const
+{
+  return mode ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief
+/// \return true if the recording dropped records, so a replay is not the
+///   game that was played
+///
+bool JournalReader :: isLossy () const
+{
+  return ( flags & BBT_JOURNAL_FLAG_LOSSY ) != 0 ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief read the next record
+/// \return false at the end of the journal
+///
+bool JournalReader :: next ( uint32_t &out_tick , int &out_event )
+{
+  if ( file == NULL )
+    return false ;
+
+  uint64_t value = 0 ;
+  int shift = 0 ;
+  int byte = 0 ;
+  do
+  {
+    byte = getc ( file ) ;
+    if ( byte == EOF || shift >= 64 )
+      return false ;
+    value |= ( uint64_t ) ( byte & 0x7F ) << shift ;
+    shift += 7 ;
+  } while ( byte & 0x80 ) ;
+
+  tick += ( uint32_t ) ( value >> BBT_JOURNAL_EVENT_BITS ) ;
+  out_tick = tick ;
+  out_event = value & ( ( 1 << BBT_JOURNAL_EVENT_BITS ) - 1 ) ;
+  return true ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief go back to the first record
+///
+void JournalReader :: rewind ()
+{
+  if ( file )
+    fseek ( file , data_start , SEEK_SET ) ;
+  tick = 0 ;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief reset the engine to the recorded seed and feed it every recorded
+///   event at its tick, as fast as possible. The engine ends at the tick of
+///   the last record.
+/// \return true if the whole journal was replayed, false if it is truncated,
+///   unreadable or lossy
+///
+bool JournalReader :: replay ( GameEngine &engine )
+{
+  if ( file == NULL )
+    return false ;
+
+  rewind () ;
+  engine . setPieceMode ( mode ) ;
+  engine . reset ( seed ) ;
+
+  uint32_t event_tick = 0 ;
+  int event = EV_NONE ;
+  while ( next ( event_tick , event ) )
+  {
+    engine . step ( NULL , 0 , event_tick - engine . getTick () ) ;
+    if ( event != EV_NONE )
+      engine . step ( &event , 1 , 0 ) ;
+  }
+  return feof ( file ) != 0 && !isLossy () ;
+}
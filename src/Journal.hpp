@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the JournalWriter and JournalReader classes used to record
+/// and replay the input of a game session
+///
+/// File layout (little endian):
+///   header: "BBTJ", uint8 version, uint8 piece mode, uint8 flags,
+///           1 byte reserved, uint64 seed
+///   records: one LEB128 varint per event, value = ( tick delta << 4 ) | event
+///
+/// The tick delta is counted from the previous record, so most records fit
+/// in a single byte. A closed journal ends with an EV_NONE record at the
+/// final tick so a replay runs for exactly as long as the recording.
+/// Closing one that dropped records sets BBT_JOURNAL_FLAG_LOSSY, since its
+/// replay is not the game that was played.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BBT_JOURNAL_H
+#define BBT_JOURNAL_H 1
+
+
+// external includes
+#include <pthread.h>
+#include <stdio.h>
+#include <atomic>
+#include <cstdint>
+
+// local includes
+#include "BBTdefines.hpp"
+#include "PieceGenerator.hpp"
+#include "SpscRing.hpp"
+
+#define BBT_JOURNAL_MAGIC "BBTJ"
+#define BBT_JOURNAL_VERSION 1
+#define BBT_JOURNAL_EVENT_BITS 4
+#define BBT_JOURNAL_BUFFER_SIZE 4096
+#define BBT_JOURNAL_BLOCKS 8
+#define BBT_JOURNAL_WRITE_NS 100000000
+#define BBT_JOURNAL_FLAG_LOSSY 1
+
+class GameEngine ;
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief records waiting to be written out
+///
+struct JournalBlock
+{
+  unsigned int used ;
+  unsigned char data [ BBT_JOURNAL_BUFFER_SIZE ] ;
+} ;
+
+///////////////////////////////////////////////////////////////////////////////
+/// \class appends consumed events to a journal file. Records are collected in
+/// fixed blocks that are handed, when full or on flush, through an SpscRing
+/// to a writer thread of the journal's own. The recording thread never makes
+/// a syscall, so under Xenomai it stays in primary mode. The writer looks
+/// for blocks every BBT_JOURNAL_WRITE_NS; if it falls BBT_JOURNAL_BLOCKS
+/// blocks behind, records are dropped and counted rather than waited for.
+///
+/// Tools that record faster than real time can write from the recording
+/// thread instead, and never drop anything.
+///////////////////////////////////////////////////////////////////////////////
+class JournalWriter
+{
+public :
+    JournalWriter ( bool background = true ) ;
+    ~JournalWriter () ;
+
+  bool open ( const char* filename , uint64_t seed , PieceGenerator :: Mode mode ) ;
+  bool isOpen () const ;
+  void record ( uint32_t tick , int event ) ;
+  void flush () ;
+  bool close ( uint32_t final_tick ) ;
+  uint32_t getLost () const ;
+  bool hasWriteFailed () const ;
+
+private :
+  FILE* file ;
+  uint32_t last_tick ;
+  uint32_t lost ;
+  bool background ;
+  JournalBlock* current ;   // being filled, NULL until the next record
+  SpscRing < JournalBlock , BBT_JOURNAL_BLOCKS > blocks ;
+  pthread_t writer ;
+  std :: atomic < bool > writing ;
+  std :: atomic < bool > write_failed ;
+
+  void writeBlocks () ;
+  void stopWriter () ;
+  static void* writerFunc ( void* in_journal ) ;
+} ;
+
+///////////////////////////////////////////////////////////////////////////////
+/// \class reads a journal written by JournalWriter
+///////////////////////////////////////////////////////////////////////////////
+class JournalReader
+{
+public :
+    JournalReader () ;
+    ~JournalReader () ;
+
+  bool open ( const char* filename ) ;
+  uint64_t getSeed () const ;
+  PieceGenerator :: Mode getMode () const ;
+  bool isLossy () const ;
+  bool next ( uint32_t &tick , int &event ) ;
+  void rewind () ;
+
+  bool replay ( GameEngine &engine ) ;
+
+private :
+  FILE* file ;
+  long data_start ;
+  uint64_t seed ;
+  PieceGenerator :: Mode mode ;
+  unsigned char flags ;
+  uint32_t tick ;
+} ;
+
+
+#endif // BBT_JOURNAL_H
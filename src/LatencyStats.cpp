@@ -0,0 +1,57 @@
+#include "LatencyStats.hpp"
+
+LatencyStats latency_stats;
+
+////////////////////////////////////////////////////////////////////////////////
+static void requestDump(int) {
+  latency_stats.dump_requested = 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LatencyStats::installSignal() {
+  signal(SIGUSR1, requestDump);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool LatencyStats::dumpIfRequested(FILE * out) {
+  if(!dump_requested) return false;
+
+  dump_requested = 0;
+  dump(out);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LatencyStats::dump(FILE * out) const {
+  fprintf(out, "input latency:\n");
+  kernel_to_enqueue.print(out, "  kernel to enqueue");
+  enqueue_to_tick.print(out, "  enqueue to tick");
+  tick_to_draw.print(out, "  tick to draw");
+  draw_to_swap.print(out, "  draw to swap");
+  input_to_swap.print(out, "  input to swap");
+
+  fprintf(out, "controller: %llu ticks, %llu after missed deadlines, %llu deadlines missed\n",
+          (unsigned long long)ticks.load(std::memory_order_relaxed),
+          (unsigned long long)overrun_ticks.load(std::memory_order_relaxed),
+          (unsigned long long)missed_periods.load(std::memory_order_relaxed));
+  tick_late.print(out, "  wakeup late");
+  tick_run.print(out, "  tick run time");
+
+  if(display_wall_ns > display_start_ns) {
+    fprintf(out, "display: %u frames drawn, %u skipped, duty cycle %.1f%%\n",
+            frames_drawn, frames_skipped,
+            100.0 * (display_cpu_ns - display_start_cpu_ns) / (display_wall_ns - display_start_ns));
+  }
+  printStartup(out);
+  fflush(out);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LatencyStats::printStartup(FILE * out) const {
+  if(first_frame_ns == 0) return;
+
+  fprintf(out, "startup: first frame after %.1f ms, images from %s in %.1f ms\n",
+          (first_frame_ns - start_ns) / 1e6, assets_from_bundle ? "bundle" : "PNG files",
+          assets_ns / 1e6);
+  fflush(out);
+}
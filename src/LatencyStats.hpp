@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the input to display latency histograms. An input event is
+/// followed through four stages, all on CLOCK_MONOTONIC:
+///   kernel  - evdev timestamp of the key press
+///   enqueue - pushed to the EventRing by the input thread
+///   tick    - consumed by a GameController tick
+///   draw    - the first frame showing that tick is ready to flush
+///   swap    - the render backend's flush returned for that frame, with GL
+///             after swapping buffers
+/// Alongside them it keeps how busy the display thread is, and how long
+/// startup took up to the first frame. The controller thread adds, for every
+/// tick, how late it woke up after its deadline, how long processTick ran
+/// and how many deadlines passed without a tick. Everything is printed when
+/// the process gets SIGUSR1, and when the display exits.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <signal.h>
+#include <stdio.h>
+#include <time.h>
+#include <atomic>
+#include <cstdint>
+#include "Histogram.hpp"
+
+inline uint64_t monotonicNs() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+struct LatencyStats {
+  Histogram kernel_to_enqueue;
+  Histogram enqueue_to_tick;
+  Histogram tick_to_draw;
+  Histogram draw_to_swap;
+  Histogram input_to_swap;    // end to end, from the earliest known timestamp
+
+  // Controller thread, recorded by it every tick
+  Histogram tick_late;        // woke up this long after the tick's deadline
+  Histogram tick_run;         // processTick
+  std::atomic<uint64_t> ticks;
+  std::atomic<uint64_t> overrun_ticks;    // ticks that came after missed ones
+  std::atomic<uint64_t> missed_periods;   // deadlines passed without a tick
+
+  // Display load, only touched by the display thread
+  uint64_t display_start_ns;  // wall and thread CPU time when it started
+  uint64_t display_start_cpu_ns;
+  uint64_t display_wall_ns;   // and at its last wakeup
+  uint64_t display_cpu_ns;
+  uint32_t frames_drawn;
+  uint32_t frames_skipped;    // woke up to new state that looked the same
+
+  // Startup, from main to the first frame on screen
+  uint64_t start_ns;          // main started
+  uint64_t assets_ns;         // time to load the images and upload the atlas
+  uint64_t first_frame_ns;    // first frame flushed
+  bool assets_from_bundle;    // mapped the bundle, or decoded the PNGs
+
+  volatile sig_atomic_t dump_requested;
+
+  LatencyStats()
+    : ticks(0), overrun_ticks(0), missed_periods(0),
+      display_start_ns(0), display_start_cpu_ns(0), display_wall_ns(0), display_cpu_ns(0),
+      frames_drawn(0), frames_skipped(0), start_ns(0), assets_ns(0), first_frame_ns(0),
+      assets_from_bundle(false), dump_requested(0) {}
+
+  // Install the SIGUSR1 handler that requests a dump
+  void installSignal();
+
+  // Print all histograms if a dump was requested, and return whether it
+  // was. Not for the RT thread.
+  bool dumpIfRequested(FILE * out);
+  void dump(FILE * out) const;
+
+  // One line with the startup times
+  void printStartup(FILE * out) const;
+};
+
+extern LatencyStats latency_stats;
+
+#endif
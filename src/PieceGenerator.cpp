@@ -0,0 +1,91 @@
+#include "PieceGenerator.hpp"
+
+static inline uint32_t rotl(uint32_t x, int k) {
+  return (x << k) | (x >> (32 - k));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Reset the generator. The state is expanded from the seed with
+///        splitmix64 so that nearby seeds give unrelated sequences.
+void PieceGenerator::seed(uint64_t value) {
+  for(int i = 0; i < 4; i += 2) {
+    uint64_t z = (value += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+
+    state[i]     = (uint32_t)z;
+    state[i + 1] = (uint32_t)(z >> 32);
+  }
+
+  bag_pos = BlockData::num_colors;
+  next_id = 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Switch between independent and 7-bag sequences, starting a new bag
+void PieceGenerator::setMode(Mode new_mode) {
+  mode = new_mode;
+  bag_pos = BlockData::num_colors;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Next raw 32 bit value (xoshiro128**)
+uint32_t PieceGenerator::next() {
+  uint32_t result = rotl(state[1] * 5, 7) * 9;
+  uint32_t t = state[1] << 9;
+
+  state[2] ^= state[0];
+  state[3] ^= state[1];
+  state[1] ^= state[2];
+  state[0] ^= state[3];
+  state[2] ^= t;
+  state[3] = rotl(state[3], 11);
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Value in [0, bound) without a division
+uint32_t PieceGenerator::nextBelow(uint32_t bound) {
+  return (uint32_t)(((uint64_t)next() * bound) >> 32);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Seed for a following game, so a whole session replays from one seed
+uint64_t PieceGenerator::nextSeed() {
+  uint64_t high = next();
+  return (high << 32) | next();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Shuffle a new bag of all piece types (Fisher-Yates)
+void PieceGenerator::refillBag() {
+  for(int i = 0; i < BlockData::num_colors; i++) {
+    bag[i] = i + 1;
+  }
+
+  for(int i = BlockData::num_colors - 1; i > 0; i--) {
+    int j = nextBelow(i + 1);
+    int tmp = bag[i];
+    bag[i] = bag[j];
+    bag[j] = tmp;
+  }
+
+  bag_pos = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Block data for the next piece, with an id unique within this game
+BlockData PieceGenerator::nextPiece() {
+  int color;
+
+  if(mode == MODE_BAG) {
+    if(bag_pos >= BlockData::num_colors) refillBag();
+    color = bag[bag_pos++];
+  } else {
+    color = nextBelow(BlockData::num_colors) + 1;
+  }
+
+  return BlockData(next_id++, color);
+}
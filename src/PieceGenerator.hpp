@@ -0,0 +1,42 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the PieceGenerator class: a seedable per-game random source
+/// for new tetrominos
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef PIECE_GENERATOR_H
+#define PIECE_GENERATOR_H
+
+#include <cstdint>
+#include "BBTdefines.hpp"
+
+// xoshiro128** generator with an optional 7-bag piece sequence. All state is
+// held in the object so games can run concurrently and replay from a seed.
+class PieceGenerator {
+public:
+  enum Mode {
+    MODE_RANDOM, // every piece chosen independently
+    MODE_BAG     // each run of 7 pieces contains every piece once
+  };
+
+  PieceGenerator() : mode(MODE_RANDOM) { seed(0); }
+
+  void seed(uint64_t value);
+  void setMode(Mode new_mode);
+  Mode getMode() const { return mode; }
+
+  uint32_t next();
+  uint32_t nextBelow(uint32_t bound);
+  uint64_t nextSeed();
+  BlockData nextPiece();
+
+private:
+  void refillBag();
+
+  uint32_t state[4];
+  Mode mode;
+  int bag[BlockData::num_colors];
+  int bag_pos;
+  int next_id;
+};
+
+#endif
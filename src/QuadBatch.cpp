@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include "QuadBatch.hpp"
+
+// glDrawArrays and the state set up around it in flush
+static const unsigned int FLUSH_GL_CALLS = 13;
+
+////////////////////////////////////////////////////////////////////////////////
+QuadBatch::QuadBatch() : atlas(NULL), texture(0) {
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool QuadBatch::load(TextureAtlas & packed_atlas) {
+  GLint max_texture_size;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+
+  if(!packed_atlas.pack(max_texture_size)) {
+    printf("Textures don't fit in a %dx%d atlas\n", max_texture_size, max_texture_size);
+    return false;
+  }
+
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, packed_atlas.getWidth(), packed_atlas.getHeight(), 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, packed_atlas.getPixels());
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  atlas = &packed_atlas;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void QuadBatch::add(AtlasId image, GLfloat x, GLfloat y, GLfloat w, GLfloat h,
+                    GLfloat s0, GLfloat t0, GLfloat s1, GLfloat t1, unsigned int rgb) {
+  const AtlasRegion & region = atlas->getRegion(image);
+  GLfloat u0 = region.u0 + s0 * (region.u1 - region.u0);
+  GLfloat u1 = region.u0 + s1 * (region.u1 - region.u0);
+  GLfloat v0 = region.v0 + t0 * (region.v1 - region.v0);
+  GLfloat v1 = region.v0 + t1 * (region.v1 - region.v0);
+
+  // Same corner order as the immediate mode quads this replaces
+  const GLfloat quad_vertices[] = {x, y, x, y + h, x + w, y + h, x + w, y};
+  const GLfloat quad_tex_coords[] = {u0, v0, u0, v1, u1, v1, u1, v0};
+  vertices.insert(vertices.end(), quad_vertices, quad_vertices + 8);
+  tex_coords.insert(tex_coords.end(), quad_tex_coords, quad_tex_coords + 8);
+
+  for(int i = 0; i < 4; i++) {
+    colors.push_back((rgb >> 16) & 0xFF);
+    colors.push_back((rgb >> 8) & 0xFF);
+    colors.push_back(rgb & 0xFF);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void QuadBatch::flush() {
+  last_flush.quads = vertices.size() / 8;
+  last_flush.calls = 0;
+  if(vertices.empty()) return;
+
+  glEnable(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, texture);
+
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glEnableClientState(GL_COLOR_ARRAY);
+
+  glVertexPointer(2, GL_FLOAT, 0, vertices.data());
+  glTexCoordPointer(2, GL_FLOAT, 0, tex_coords.data());
+  glColorPointer(3, GL_UNSIGNED_BYTE, 0, colors.data());
+  glDrawArrays(GL_QUADS, 0, vertices.size() / 2);
+
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisable(GL_TEXTURE_2D);
+  last_flush.calls = FLUSH_GL_CALLS;
+
+  vertices.clear();
+  tex_coords.clear();
+  colors.clear();
+}
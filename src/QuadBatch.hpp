@@ -0,0 +1,41 @@
+#ifndef QUAD_BATCH_H
+#define QUAD_BATCH_H
+
+#include <vector>
+#include <GL/gl.h>
+#include "RenderBackend.hpp"
+#include "TextureAtlas.hpp"
+
+// Collects textured, coloured quads from one texture atlas and draws them all
+// with a single glDrawArrays, instead of one immediate mode glBegin/glEnd and
+// texture bind per quad. Quads are drawn in the order they were added, in the
+// modelview matrix current when flushed. The arrays keep their capacity, so
+// after the first few frames nothing is allocated. Draws into whatever GL
+// context is current; SdlBackend adds the window around it.
+class QuadBatch : public RenderBackend {
+public:
+  QuadBatch();
+
+  bool open() { return true; }
+
+  // Pack the atlas up to GL_MAX_TEXTURE_SIZE and upload it as a texture
+  bool load(TextureAtlas & atlas);
+
+  void add(AtlasId image, GLfloat x, GLfloat y, GLfloat w, GLfloat h,
+           GLfloat s0, GLfloat t0, GLfloat s1, GLfloat t1, unsigned int rgb);
+
+  bool empty() const { return vertices.empty(); }
+
+  // Draw and forget everything added so far
+  void flush();
+
+private:
+  const TextureAtlas * atlas;
+  GLuint texture;
+
+  std::vector<GLfloat> vertices;
+  std::vector<GLfloat> tex_coords;
+  std::vector<GLubyte> colors;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#include "RenderBackend.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+void RenderBackend::addBox(AtlasId image, float x, float y, float w, float h, unsigned int rgb) {
+  add(image, x, y, w, h, 0.0f, 1.0f, 1.0f, 0.0f, rgb);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Each part samples the matching region of its image, so the nine parts of
+// a block line up into one seamless tile, the same as its sprite
+void RenderBackend::addBlock(float x, float y, float size, const BlockTextureMap & map) {
+  if(map.color == 0) {
+    // Just draw a black box
+    addBox(TextureAtlas::WHITE, x, y, size, size, map.color);
+    return;
+  }
+
+  // One quad for the whole block. Scaled down, the nine parts are filtered
+  // each on its own, which a sprite can't reproduce exactly.
+  if(map.sprite != 0 && size == 1.0f) {
+    addBox(map.sprite, x, y, size, size, map.color);
+    return;
+  }
+
+  static const float offsets[] = {0.00f, 0.25f, 0.75f};
+  static const float sizes[] = {0.25f, 0.50f, 0.25f};
+
+  for(int i = 0; i < 3; i++) {
+    for(int j = 0; j < 3; j++) {
+      float px = offsets[i], py = offsets[j];
+      float pw = sizes[i], ph = sizes[j];
+      add(map.tex[i][j], x + px * size, y + py * size, pw * size, ph * size,
+          px, 1.0f - py, px + pw, 1.0f - py - ph, map.color);
+    }
+  }
+}
@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the RenderBackend interface the display draws through. The
+/// display works in board units with y up, AREA_WIDTH by AREA_HEIGHT of them
+/// on the screen, and only draws images from one TextureAtlas. A backend puts
+/// the quads it is given on screen: QuadBatch and SdlBackend with OpenGL,
+/// SoftBackend into a memory buffer or a Linux framebuffer.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef RENDER_BACKEND_H
+#define RENDER_BACKEND_H
+
+#include "BBTdefines.hpp"
+#include "BlockTextureMap.hpp"
+#include "TextureAtlas.hpp"
+
+const float AREA_WIDTH  = (float)BBT_SCREEN_WIDTH / BBT_BLOCK_PIXELS;
+const float AREA_HEIGHT = (float)BBT_SCREEN_HEIGHT / BBT_BLOCK_PIXELS;
+
+class RenderBackend {
+public:
+  // What one flush put on screen: quads, and the calls into the driver that
+  // took, i.e. GL calls or framebuffer rectangles copied
+  struct FlushCounts {
+    unsigned int quads;
+    unsigned int calls;
+  };
+
+  RenderBackend() : last_flush() {}
+  virtual ~RenderBackend() {}
+
+  // Set up the output, e.g. create the window. Prints why and returns false
+  // if it can't.
+  virtual bool open() = 0;
+
+  // Pack the atlas as large as this backend can take, and keep its pixels.
+  // Returns false if the images don't fit. Call once, after open.
+  virtual bool load(TextureAtlas & atlas) = 0;
+
+  // Quad from (x, y) to (x + w, y + h), showing image texture coordinates
+  // (s0, t0) at (x, y) to (s1, t1) at the opposite corner, each texel
+  // multiplied by rgb
+  virtual void add(AtlasId image, float x, float y, float w, float h,
+                   float s0, float t0, float s1, float t1, unsigned int rgb) = 0;
+
+  // True if nothing was added since the last flush
+  virtual bool empty() const = 0;
+
+  // Get everything added since the last flush on screen, in the order added
+  virtual void flush() = 0;
+
+  const FlushCounts & getLastFlush() const { return last_flush; }
+
+  // Handle window system events. Returns false once the user asked to quit.
+  virtual bool poll() { return true; }
+
+  // The whole image, upright, stretched over the box
+  void addBox(AtlasId image, float x, float y, float w, float h, unsigned int rgb = 0xFFFFFF);
+
+  // A size by size block at (x, y): its sprite at full size, nine parts
+  // otherwise, or a plain box if black
+  void addBlock(float x, float y, float size, const BlockTextureMap & map);
+
+protected:
+  FlushCounts last_flush;   // set by flush
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include <signal.h>
+#include <stdio.h>
+#include <GL/gl.h>
+#include <GL/glu.h>
+#include <SDL/SDL.h>
+#include "SdlBackend.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+bool SdlBackend::open() {
+  SDL_Init(SDL_INIT_VIDEO);
+  SDL_ShowCursor(0);
+  SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+  SDL_GL_SetAttribute(SDL_GL_SWAP_CONTROL, 1);
+
+  // Attempt to create portrait orientation surface
+  SDL_Surface *surface = SDL_SetVideoMode(BBT_SCREEN_WIDTH, BBT_SCREEN_HEIGHT, 0, SDL_OPENGL | SDL_FULLSCREEN);
+
+  // If we fail to create the first surface, assume that we're running
+  // in landscape on the LCD CAPE and rotate here
+  bool rotate_display = false;
+  if(surface == NULL) {
+    rotate_display = true;
+    surface = SDL_SetVideoMode(BBT_SCREEN_HEIGHT, BBT_SCREEN_WIDTH, 0, SDL_OPENGL | SDL_FULLSCREEN);
+  }
+
+  // Still failed. WTF?
+  if(surface == NULL) {
+    printf("Failed to create video surface: %s\n", SDL_GetError());
+    return false;
+  }
+
+  // Don't let SDL stomp on these
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+
+  // Set up projection -- reversed if display rotated
+  glViewport(0, 0, surface->w, surface->h);
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+
+  if(rotate_display) {
+    gluOrtho2D(0.0, AREA_HEIGHT, 0.0, AREA_WIDTH);
+  } else {
+    gluOrtho2D(0.0, AREA_WIDTH, 0.0, AREA_HEIGHT);
+  }
+
+  glMatrixMode(GL_MODELVIEW);
+  glLoadIdentity();
+
+  // If rotated, rotate around center and return to bottom-left corner
+  if(rotate_display) {
+    glTranslatef(AREA_HEIGHT / 2.0, AREA_WIDTH / 2.0, 0.0);
+    glRotatef(-90.0f, 0.0f, 0.0f, 1.0f);
+    glTranslatef(-AREA_WIDTH / 2.0, -AREA_HEIGHT / 2.0, 0.0);
+  }
+
+  glDisable(GL_DEPTH_TEST);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SdlBackend::flush() {
+  QuadBatch::flush();
+  SDL_GL_SwapBuffers();
+  last_flush.calls++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool SdlBackend::poll() {
+  SDL_Event event;
+  while(SDL_PollEvent(&event)) {
+    if(event.type == SDL_QUIT) return false;
+  }
+  return true;
+}
@@ -0,0 +1,15 @@
+#ifndef SDL_BACKEND_H
+#define SDL_BACKEND_H
+
+#include "QuadBatch.hpp"
+
+// Draws with OpenGL into a full screen SDL window, rotated if the screen is
+// landscape, and swaps buffers on every flush
+class SdlBackend : public QuadBatch {
+public:
+  bool open();
+  void flush();
+  bool poll();
+};
+
+#endif
@@ -0,0 +1,476 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file implement the SessionHost class
+///////////////////////////////////////////////////////////////////////////////
+
+// this module's h file.
+#include "SessionHost.hpp"
+
+// external includes
+#include <poll.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+// local includes
+#include "EventRing.hpp"
+#include "GameEngine.hpp"
+#include "LatencyStats.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief one game. Only its worker touches the engine and the schedule,
+///   anyone can push input and read the status
+///
+struct SessionHost :: Session
+{
+  GameEngine engine ;
+  EventRing input ;
+  std :: atomic < bool > input_pending ;  // pushed to since the worker last looked
+  Worker* worker ;
+  uint32_t next_tick ;                    // engine tick to wake up for, 0 if idle
+
+  std :: atomic < uint32_t > tick ;
+  std :: atomic < uint32_t > score ;
+  std :: atomic < uint32_t > level ;
+  std :: atomic < uint32_t > lines_cleared ;
+  std :: atomic < uint32_t > flags ;      // 1 paused, 2 game over
+} ;
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief one thread and the sessions it runs
+///
+struct SessionHost :: Worker
+{
+  SessionHost* host ;
+  unsigned int index ;
+  bool pin ;
+  bool started ;
+  pthread_t thread ;
+  int wake_fd ;                           // eventfd, for input and stop
+  int timer_fd ;                          // the earliest session tick
+  std :: vector < Session* > sessions ;
+  std :: atomic < uint64_t > wakeups ;
+  std :: atomic < uint64_t > cpu_ns ;
+} ;
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief
+///
+SessionHost :: SessionHost ( unsigned int n_threads )
+  : running ( false )
+  , epoch ( 0 )
+{
+  if ( n_threads == 0 )
+    n_threads = 1 ;
+
+  for ( unsigned int loop = 0 ; loop < n_threads ; ++loop )
+  {
+    Worker* worker = new Worker ;
+    worker -> host = this ;
+    worker -> index = loop ;
+    worker -> pin = false ;
+    worker -> started = false ;
+    worker -> wake_fd = -1 ;
+    worker -> timer_fd = -1 ;
+    worker -> wakeups . store ( 0 ) ;
+    worker -> cpu_ns . store ( 0 ) ;
+    workers . push_back ( worker ) ;
+  }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief
+///
+SessionHost :: ~SessionHost ()
+{
+  stop () ;
+  for ( unsigned int loop = 0 ; loop < workers . size () ; ++loop )
+  {
+    delete workers [ loop ] ;
+  }
+  for ( unsigned int loop = 0 ; loop < sessions . size () ; ++loop )
+  {
+    delete sessions [ loop ] ;
+  }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief add a game started from seed, paused as a new game is. Sessions
+///   are dealt to the threads in turn. Must be called before start, input
+///   can already be pushed
+/// \return the session's number, for push and getStatus
+///
+unsigned int SessionHost :: addSession ( uint64_t seed )
+{
+  Session* session = new Session ;
+  session -> engine . reset ( seed ) ;
+  session -> input_pending . store ( false ) ;
+  session -> next_tick = 0 ;
+  session -> tick . store ( 0 ) ;
+  session -> score . store ( 0 ) ;
+  session -> level . store ( session -> engine . snapshot () . level ) ;
+  session -> lines_cleared . store ( 0 ) ;
+  session -> flags . store ( 1 ) ;
+
+  unsigned int id = sessions . size () ;
+  session -> worker = workers [ id % workers . size () ] ;
+  session -> worker -> sessions . push_back ( session ) ;
+  sessions . push_back ( session ) ;
+  return id ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief start the threads. Tick 0 of every session is due now, so a
+///   session's tick numbers are the grid's. With pin_threads, thread n only
+///   runs on cpu n, wrapping around
+/// \return false if a thread or its fds could not be created
+///
+bool SessionHost :: start ( bool pin_threads )
+{
+  if ( running . load () )
+    return false ;
+
+  for ( unsigned int loop = 0 ; loop < workers . size () ; ++loop )
+  {
+    Worker* worker = workers [ loop ] ;
+    worker -> pin = pin_threads ;
+    // readable at once, so input pushed before start is seen
+    worker -> wake_fd = eventfd ( 1 , EFD_NONBLOCK | EFD_CLOEXEC ) ;
+    worker -> timer_fd = timerfd_create ( CLOCK_MONOTONIC , TFD_CLOEXEC ) ;
+    if ( worker -> wake_fd < 0 || worker -> timer_fd < 0 )
+    {
+      printf ( "SessionHost: no eventfd or timerfd for thread %u\n" , loop ) ;
+      return false ;
+    }
+  }
+
+  epoch = monotonicNs () ;
+  running . store ( true , std :: memory_order_release ) ;
+
+  for ( unsigned int loop = 0 ; loop < workers . size () ; ++loop )
+  {
+    if ( pthread_create ( &workers [ loop ] -> thread , NULL , workerFunc , workers [ loop ] ) != 0 )
+    {
+      printf ( "SessionHost: failed to create thread %u\n" , loop ) ;
+      stop () ;
+      return false ;
+    }
+    workers [ loop ] -> started = true ;
+  }
+  return true ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief wake every thread and wait for it to finish. The sessions keep
+///   their state, but take no more ticks
+///
+void SessionHost :: stop ()
+{
+  running . store ( false , std :: memory_order_release ) ;
+
+  for ( unsigned int loop = 0 ; loop < workers . size () ; ++loop )
+  {
+    Worker* worker = workers [ loop ] ;
+    if ( worker -> started )
+    {
+      uint64_t one = 1 ;
+      ssize_t written = write ( worker -> wake_fd , &one , sizeof ( one ) ) ;
+      ( void ) written ;
+      pthread_join ( worker -> thread , NULL ) ;
+      worker -> started = false ;
+    }
+    if ( worker -> wake_fd >= 0 )
+    {
+      close ( worker -> wake_fd ) ;
+      worker -> wake_fd = -1 ;
+    }
+    if ( worker -> timer_fd >= 0 )
+    {
+      close ( worker -> timer_fd ) ;
+      worker -> timer_fd = -1 ;
+    }
+  }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief send what pushFrom gets from source, e.g. an input device or a
+///   bot, to session from now on. Several sources can play one session. Must
+///   be called before start, so pushFrom can look routes up without locking
+/// \return false if the session does not exist or the threads are running
+///
+bool SessionHost :: bindSource ( unsigned int source , unsigned int session )
+{
+  if ( session >= sessions . size () || running . load () )
+    return false ;
+
+  routes [ source ] = session ;
+  return true ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief queue an event for a session and wake its thread, which applies it
+///   at once. Any thread. Pushes that come in before the thread gets to it
+///   share one wakeup
+/// \return false if the session does not exist or its ring dropped the event
+///
+bool SessionHost :: push ( unsigned int session , int event , uint64_t time_ns )
+{
+  if ( session >= sessions . size () )
+    return false ;
+
+  Session* target = sessions [ session ] ;
+  bool queued = target -> input . push ( event , time_ns ) ;
+  if ( !target -> input_pending . exchange ( true , std :: memory_order_acq_rel ) )
+  {
+    uint64_t one = 1 ;
+    ssize_t written = write ( target -> worker -> wake_fd , &one , sizeof ( one ) ) ;
+    ( void ) written ;
+  }
+  return queued ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief push an event to the session source is bound to. Any thread
+/// \return false if source is not bound or the event was dropped
+///
+bool SessionHost :: pushFrom ( unsigned int source , int event , uint64_t time_ns )
+{
+  std :: map < unsigned int , unsigned int > :: const_iterator route = routes . find ( source ) ;
+  if ( route == routes . end () )
+    return false ;
+
+  return push ( route -> second , event , time_ns ) ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief the session as of the last time its thread ran it. Any thread.
+///   The fields are read one by one, so they can be from different ticks
+///
+SessionStatus SessionHost :: getStatus ( unsigned int session ) const
+{
+  SessionStatus status ;
+  memset ( &status , 0 , sizeof ( status ) ) ;
+  if ( session >= sessions . size () )
+    return status ;
+
+  const Session* source = sessions [ session ] ;
+  uint32_t flags = source -> flags . load ( std :: memory_order_acquire ) ;
+  status . tick = source -> tick . load ( std :: memory_order_relaxed ) ;
+  status . score = source -> score . load ( std :: memory_order_relaxed ) ;
+  status . level = source -> level . load ( std :: memory_order_relaxed ) ;
+  status . lines_cleared = source -> lines_cleared . load ( std :: memory_order_relaxed ) ;
+  status . paused = flags & 1 ;
+  status . game_over = ( flags & 2 ) != 0 ;
+  return status ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief number of sessions added
+///
+unsigned int SessionHost :: getSessionCount () const
+{
+  return sessions . size () ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief number of threads the sessions are spread over
+///
+unsigned int SessionHost :: getThreadCount () const
+{
+  return workers . size () ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief times any thread woke up, for input or a due tick
+///
+uint64_t SessionHost :: getWakeups () const
+{
+  uint64_t total = 0 ;
+  for ( unsigned int loop = 0 ; loop < workers . size () ; ++loop )
+  {
+    total += workers [ loop ] -> wakeups . load ( std :: memory_order_relaxed ) ;
+  }
+  return total ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief CPU time all threads have used, as of their last wakeup
+///
+uint64_t SessionHost :: getThreadCpuNs () const
+{
+  uint64_t total = 0 ;
+  for ( unsigned int loop = 0 ; loop < workers . size () ; ++loop )
+  {
+    total += workers [ loop ] -> cpu_ns . load ( std :: memory_order_relaxed ) ;
+  }
+  return total ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief for every session tick woken up for, how long after it was due
+///   the session ran
+///
+const Histogram& SessionHost :: getTickLateness () const
+{
+  return tick_late ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief for every event pushed with a time, from that time until the
+///   session applied it
+///
+const Histogram& SessionHost :: getInputLatency () const
+{
+  return input_latency ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief bring one session up to grid_tick if it has input or a tick that
+///   changes something is due, then schedule its next wakeup. Ticks in
+///   between only count, so they run in one step
+///
+void SessionHost :: runSession ( Session &session , uint32_t grid_tick , uint64_t now )
+{
+  bool input = session . input_pending . exchange ( false , std :: memory_order_acq_rel ) ;
+  bool due = session . next_tick && grid_tick >= session . next_tick ;
+  if ( !input && !due )
+    return ;
+
+  GameEngine& engine = session . engine ;
+  if ( due )
+  {
+    tick_late . record ( now - ( epoch + ( uint64_t ) session . next_tick * BBT_TICK_PERIOD_NS ) ) ;
+  }
+  engine . step ( NULL , 0 , grid_tick - engine . getTick () ) ;
+
+  if ( input )
+  {
+    InputEvent queued [ BBT_EVENT_QUEUE_SIZE ] ;
+    int events [ BBT_EVENT_QUEUE_SIZE ] ;
+    unsigned int n_events ;
+    while ( ( n_events = session . input . drain ( queued , BBT_EVENT_QUEUE_SIZE ) ) > 0 )
+    {
+      for ( unsigned int loop = 0 ; loop < n_events ; ++loop )
+      {
+        events [ loop ] = queued [ loop ] . event ;
+        if ( queued [ loop ] . time_ns && queued [ loop ] . time_ns <= now )
+          input_latency . record ( now - queued [ loop ] . time_ns ) ;
+      }
+      engine . step ( events , n_events , 0 ) ;
+    }
+  }
+
+  unsigned int ticks = engine . ticksUntilChange () ;
+  session . next_tick = ticks ? engine . getTick () + ticks : 0 ;
+
+  const GameState& state = engine . snapshot () ;
+  session . tick . store ( engine . getTick () , std :: memory_order_relaxed ) ;
+  session . score . store ( state . score , std :: memory_order_relaxed ) ;
+  session . level . store ( state . level , std :: memory_order_relaxed ) ;
+  session . lines_cleared . store ( state . lines_cleared , std :: memory_order_relaxed ) ;
+  session . flags . store ( ( state . paused ? 1 : 0 ) | ( state . game_over ? 2 : 0 )
+                        , std :: memory_order_release ) ;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief thread loop: sleep until input is pushed to one of the thread's
+///   sessions or the earliest of their next ticks is due, then run every
+///   session that has either in one pass
+/// \return NULL once stopped
+///
+void* SessionHost :: workerFunc ( void* in_worker )
+{
+  Worker* worker = ( Worker* ) in_worker ;
+  SessionHost* host = worker -> host ;
+
+  if ( worker -> pin )
+  {
+    cpu_set_t cpus ;
+    CPU_ZERO ( &cpus ) ;
+    CPU_SET ( worker -> index % sysconf ( _SC_NPROCESSORS_ONLN ) , &cpus ) ;
+    pthread_setaffinity_np ( pthread_self () , sizeof ( cpus ) , &cpus ) ;
+  }
+
+  pollfd fds [ 2 ] = { { worker -> wake_fd , POLLIN , 0 } , { worker -> timer_fd , POLLIN , 0 } } ;
+  uint64_t count ;
+  ssize_t got = 0 ;
+
+  while ( host -> running . load ( std :: memory_order_acquire ) )
+  {
+    if ( poll ( fds , 2 , -1 ) < 0 )
+      continue ;
+    if ( fds [ 0 ] . revents & POLLIN )
+      got = read ( worker -> wake_fd , &count , sizeof ( count ) ) ;
+    if ( fds [ 1 ] . revents & POLLIN )
+      got = read ( worker -> timer_fd , &count , sizeof ( count ) ) ;
+    ( void ) got ;
+
+    uint64_t now = monotonicNs () ;
+    uint32_t grid_tick = ( now - host -> epoch ) / BBT_TICK_PERIOD_NS ;
+    uint32_t next_tick = 0 ;
+
+    for ( unsigned int loop = 0 ; loop < worker -> sessions . size () ; ++loop )
+    {
+      Session& session = *worker -> sessions [ loop ] ;
+      host -> runSession ( session , grid_tick , now ) ;
+      if ( session . next_tick && ( next_tick == 0 || session . next_tick < next_tick ) )
+        next_tick = session . next_tick ;
+    }
+
+    // disarmed while every session is idle
+    itimerspec next ;
+    memset ( &next , 0 , sizeof ( next ) ) ;
+    if ( next_tick )
+    {
+      uint64_t deadline = host -> epoch + ( uint64_t ) next_tick * BBT_TICK_PERIOD_NS ;
+      next . it_value . tv_sec = deadline / 1000000000ULL ;
+      next . it_value . tv_nsec = deadline % 1000000000ULL ;
+    }
+    timerfd_settime ( worker -> timer_fd , TFD_TIMER_ABSTIME , &next , NULL ) ;
+
+    timespec cpu ;
+    clock_gettime ( CLOCK_THREAD_CPUTIME_ID , &cpu ) ;
+    worker -> cpu_ns . store ( ( uint64_t ) cpu . tv_sec * 1000000000ULL + cpu . tv_nsec
+                             , std :: memory_order_relaxed ) ;
+    worker -> wakeups . fetch_add ( 1 , std :: memory_order_relaxed ) ;
+  }
+
+  return NULL ;
+}
@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the SessionHost class
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TETRIS_SESSION_HOST_H
+#define TETRIS_SESSION_HOST_H 1
+
+
+// external includes
+#include <pthread.h>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// local includes
+#include "BBTdefines.hpp"
+#include "Histogram.hpp"
+
+///////////////////////////////////////////////////////////////////////////////
+/// \brief what a session looked like after the last time it ran
+///
+struct SessionStatus
+{
+  uint32_t tick ;
+  unsigned int score ;
+  unsigned int level ;
+  unsigned int lines_cleared ;
+  bool paused ;
+  bool game_over ;
+} ;
+
+///////////////////////////////////////////////////////////////////////////////
+/// \class runs many independent games in one process, each with its own
+/// GameEngine, seed and EventRing, on a small pool of threads. Every session
+/// belongs to one thread. Ticks are due on one grid a period apart for all of
+/// them, so sessions due at the same tick run in the same wakeup, and a
+/// thread sleeps until the earliest tick any of its sessions changes at, as
+/// the tickless controller does, or until input is pushed to one of them.
+/// Paused and finished games cost nothing until their next input.
+///
+/// Sessions are added before start. Input can come from any thread, e.g.
+/// input devices or bots, and status can be read from any thread. Input goes
+/// to a session by number, or by the number of the source it came from once
+/// that source is bound to a session, so a device or bot need not know which
+/// game it plays.
+///////////////////////////////////////////////////////////////////////////////
+class SessionHost
+{
+public :
+    SessionHost ( unsigned int n_threads ) ;
+    ~SessionHost () ;
+  unsigned int addSession ( uint64_t seed ) ;
+  bool start ( bool pin_threads = false ) ;
+  void stop () ;
+
+  bool bindSource ( unsigned int source , unsigned int session ) ;
+
+  bool push ( unsigned int session , int event , uint64_t time_ns ) ;
+  bool pushFrom ( unsigned int source , int event , uint64_t time_ns ) ;
+  SessionStatus getStatus ( unsigned int session ) const ;
+  unsigned int getSessionCount () const ;
+  unsigned int getThreadCount () const ;
+
+  uint64_t getWakeups () const ;
+  uint64_t getThreadCpuNs () const ;
+  const Histogram& getTickLateness () const ;
+  const Histogram& getInputLatency () const ;
+
+private :
+  struct Session ;
+  struct Worker ;
+
+  std :: vector < Session* > sessions ;
+  std :: vector < Worker* > workers ;
+  std :: map < unsigned int , unsigned int > routes ;  // source to session
+  std :: atomic < bool > running ;
+  uint64_t epoch ;
+  Histogram tick_late ;
+  Histogram input_latency ;
+
+  void runSession ( Session &session , uint32_t grid_tick , uint64_t now ) ;
+  static void* workerFunc ( void* in_worker ) ;
+} ;
+
+
+#endif // TETRIS_SESSION_HOST_H
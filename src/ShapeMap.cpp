@@ -0,0 +1,132 @@
+#include "ShapeMap.hpp"
+
+// Keys for the cells just off the left and right edges of a row and for the
+// row above the top one. Cell keys have the id in the high word and the color
+// in the low word, so a color this large never occurs.
+static const uint64_t EDGE_KEY = ~0ULL;
+static const uint64_t ABOVE_TOP_KEY = ~1ULL;
+
+////////////////////////////////////////////////////////////////////////////////
+// Bit i of nibble n spread to bit 16 * i, the lowest bit of 16 bit lane i
+static uint64_t spreadNibble(unsigned int n) {
+  static const uint64_t table[16] = {
+    0x0000000000000000ULL, 0x0000000000000001ULL, 0x0000000000010000ULL, 0x0000000000010001ULL,
+    0x0000000100000000ULL, 0x0000000100000001ULL, 0x0000000100010000ULL, 0x0000000100010001ULL,
+    0x0001000000000000ULL, 0x0001000000000001ULL, 0x0001000000010000ULL, 0x0001000000010001ULL,
+    0x0001000100000000ULL, 0x0001000100000001ULL, 0x0001000100010000ULL, 0x0001000100010001ULL };
+  return table[n & 0xF];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// One bit per 16 bit lane of diff, bit i set if lane i is not zero
+static RowMask nonZeroLanes(uint64_t diff) {
+  const uint64_t low = 0x7FFF7FFF7FFF7FFFULL;
+  uint64_t flags = (((diff & low) + low) | diff) & ~low;
+
+  // Gather the flags from bits 15, 31, 47 and 63 into bits 48-51
+  return (RowMask)((((flags >> 15) * 0x0001000200040008ULL) >> 48) & 0xF);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ShapeMap::ShapeMap() {
+  RowLinks none = {0, 0, 0, 0};
+  links.fill(none);
+  for(auto & row : keys) row.fill(0);
+  for(auto & row : shapes) row.fill(0);
+  changed.fill(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Copy row y out of the board as one comparable word per cell
+void ShapeMap::updateKeys(const BoardState & board, int y) {
+  KeyRow & row = keys[y];
+  row[0] = row[BOARD_WIDTH + 1] = EDGE_KEY;
+
+  for(int x = 0; x < BOARD_WIDTH; x++) {
+    const BlockData & block = board.get(x, y);
+    row[x + 1] = (uint64_t)(uint32_t)block.id << 32 | (uint32_t)block.color;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Compare the cells of row y with the cell on their right and the
+/// three cells above, without a branch
+void ShapeMap::updateLinks(int y) {
+  static const KeyRow above_top = {{ABOVE_TOP_KEY, ABOVE_TOP_KEY, ABOVE_TOP_KEY, ABOVE_TOP_KEY,
+                                    ABOVE_TOP_KEY, ABOVE_TOP_KEY, ABOVE_TOP_KEY, ABOVE_TOP_KEY,
+                                    ABOVE_TOP_KEY, ABOVE_TOP_KEY, ABOVE_TOP_KEY, ABOVE_TOP_KEY}};
+  const KeyRow & here = keys[y];
+  const KeyRow & above = y + 1 < BOARD_HEIGHT ? keys[y + 1] : above_top;
+
+  RowLinks row = {0, 0, 0, 0};
+  for(int x = 0; x < BOARD_WIDTH; x++) {
+    row.right    |= (RowMask)(here[x + 1] == here[x + 2]) << x;
+    row.up       |= (RowMask)(here[x + 1] == above[x + 1]) << x;
+    row.up_left  |= (RowMask)(here[x + 1] == above[x]) << x;
+    row.up_right |= (RowMask)(here[x + 1] == above[x + 2]) << x;
+  }
+  links[y] = row;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Build the shapes of row y four cells per word from its links and
+/// those of the row below, and mark the cells whose shape changed
+void ShapeMap::updateShapes(const BoardState & board, int y) {
+  const RowLinks & here = links[y];
+  RowLinks below = {0, 0, 0, 0};
+  if(y > 0) below = links[y - 1];
+
+  // Links to the left and down are those of the neighbour, the other way
+  RowMask neighbours[8] = {
+    (RowMask)(below.up_right << 1), below.up, (RowMask)(below.up_left >> 1),
+    (RowMask)(here.right << 1), here.right,
+    here.up_left, here.up, here.up_right };
+  RowMask occupied = board.getRow(y);
+
+  RowMask row_changed = 0;
+  for(int word = 0; word < row_words; word++) {
+    int shift = 4 * word;
+
+    uint64_t shape = 0;
+    for(int bit = 0; bit < 8; bit++) {
+      shape |= spreadNibble(neighbours[bit] >> shift) << bit;
+    }
+
+    for(int lane = 0; lane < 4 && shift + lane < BOARD_WIDTH; lane++) {
+      shape |= (keys[y][shift + lane + 1] & 0x7) << (16 * lane + SHAPE_COLOR_SHIFT);
+    }
+
+    // Empty cells look the same whatever their neighbours
+    shape &= spreadNibble(occupied >> shift) * 0xFFFF;
+
+    row_changed |= nonZeroLanes(shape ^ shapes[y][word]) << shift;
+    shapes[y][word] = shape;
+  }
+
+  changed[y] |= row_changed & FULL_ROW_MASK;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The keys of the changed rows have to be in place before any links that use
+// them, and the links of a row only depend on the row and the one above it,
+// both included in rows if either has changed
+void ShapeMap::update(const BoardState & board, const std::array<RowMask, BOARD_HEIGHT> & rows) {
+  for(int y = 0; y < BOARD_HEIGHT; y++) {
+    if(rows[y]) updateKeys(board, y);
+  }
+
+  for(int y = 0; y < BOARD_HEIGHT; y++) {
+    if(rows[y]) updateLinks(y);
+  }
+
+  for(int y = 0; y < BOARD_HEIGHT; y++) {
+    if(rows[y]) updateShapes(board, y);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void ShapeMap::updateAll(const BoardState & board) {
+  for(int y = 0; y < BOARD_HEIGHT; y++) updateKeys(board, y);
+  for(int y = 0; y < BOARD_HEIGHT; y++) updateLinks(y);
+  for(int y = 0; y < BOARD_HEIGHT; y++) updateShapes(board, y);
+}
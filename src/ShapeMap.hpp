@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the ShapeMap class: for every cell of the board as drawn, a
+/// 16 bit BlockShape with the cell's color and which of its eight neighbours
+/// belong to the same block. That is everything that decides how the cell is
+/// drawn, so two equal shapes look the same on screen. Shapes are computed a
+/// row at a time from bit masks, only for rows near changed cells, and built
+/// and compared with the previous frame four cells per 64 bit word.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SHAPE_MAP_H
+#define SHAPE_MAP_H
+
+#include <array>
+#include <cstdint>
+#include "BBTdefines.hpp"
+#include "BoardState.hpp"
+
+// Bits 0-7: neighbours that are part of the same block, bits 8-10: color.
+// Empty cells are always 0, whatever their neighbours.
+typedef uint16_t BlockShape;
+
+// Neighbour bits, by their offset from the cell
+enum {
+  SHAPE_DOWN_LEFT = 1 << 0, SHAPE_DOWN = 1 << 1, SHAPE_DOWN_RIGHT = 1 << 2,
+  SHAPE_LEFT      = 1 << 3,                      SHAPE_RIGHT      = 1 << 4,
+  SHAPE_UP_LEFT   = 1 << 5, SHAPE_UP   = 1 << 6, SHAPE_UP_RIGHT   = 1 << 7
+};
+
+const int SHAPE_COLOR_SHIFT = 8;
+const BlockShape SHAPE_NEIGHBOURS = 0xFF;
+
+// How each cell of a row relates to the cell on its right and the three cells
+// in the row above: bit x set where the cell at x is the same block
+struct RowLinks {
+  RowMask right, up, up_left, up_right;
+};
+
+class ShapeMap {
+public:
+  ShapeMap();
+
+  // Recompute the rows that have any cell set in rows, which must include
+  // every changed cell and its neighbours. Cells whose shape changed are
+  // added to the changed masks.
+  void update(const BoardState & board, const std::array<RowMask, BOARD_HEIGHT> & rows);
+
+  // Recompute every row
+  void updateAll(const BoardState & board);
+
+  BlockShape get(int x, int y) const {
+    return (BlockShape)(shapes[y][x / 4] >> (16 * (x % 4)));
+  }
+
+  // Cells of row y with a new shape since the last clearChanged
+  RowMask getChanged(int y) const { return changed[y]; }
+  void clearChanged() { changed.fill(0); }
+
+private:
+  // Four shapes per word, so that a row compares as three whole words
+  static const int row_words = (BOARD_WIDTH + 3) / 4;
+
+  // Each cell as one comparable word, with one more off each end of the row
+  typedef std::array<uint64_t, BOARD_WIDTH + 2> KeyRow;
+
+  void updateKeys(const BoardState & board, int y);
+  void updateLinks(int y);
+  void updateShapes(const BoardState & board, int y);
+
+  std::array<KeyRow, BOARD_HEIGHT> keys;
+  std::array<RowLinks, BOARD_HEIGHT> links;
+  std::array<std::array<uint64_t, row_words>, BOARD_HEIGHT> shapes;
+  std::array<RowMask, BOARD_HEIGHT> changed;
+};
+
+#endif
@@ -0,0 +1,323 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/fb.h>
+#include <algorithm>
+#include "SoftBackend.hpp"
+
+// Largest atlas to pack into. Only memory limits it, this is plenty.
+static const int MAX_ATLAS_SIZE = 2048;
+
+// Rectangles flushed separately before they are merged into one
+static const size_t MAX_DIRTY = 64;
+
+////////////////////////////////////////////////////////////////////////////////
+// a + (b - a) * f / 256 for each channel of two 0x00RRGGBB pixels
+static inline uint32_t lerpPixel(uint32_t a, uint32_t b, unsigned int f) {
+  uint32_t rb = ((a & 0xFF00FF) * (256 - f) + (b & 0xFF00FF) * f) >> 8;
+  uint32_t g = ((a & 0x00FF00) * (256 - f) + (b & 0x00FF00) * f) >> 8;
+  return (rb & 0xFF00FF) | (g & 0x00FF00);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// a * b / 255, rounded, as GL_MODULATE does it
+static inline uint32_t mulChannel(uint32_t a, uint32_t b) {
+  uint32_t t = a * b + 0x80;
+  return (t + (t >> 8)) >> 8;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static inline uint32_t modulate(uint32_t pixel, unsigned int rgb) {
+  return mulChannel(pixel >> 16 & 0xFF, rgb >> 16 & 0xFF) << 16 |
+         mulChannel(pixel >> 8 & 0xFF, rgb >> 8 & 0xFF) << 8 |
+         mulChannel(pixel & 0xFF, rgb & 0xFF);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static inline int area(int x0, int y0, int x1, int y1) {
+  return (x1 - x0) * (y1 - y0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SoftBackend::SoftBackend(const char * fb_device)
+  : fb_device(fb_device), fb_fd(-1), fb_map(NULL), fb_map_size(0), fb_origin(NULL),
+    fb_pitch(0), fb_bytes(0), fb_rotate(false), atlas(NULL), quads(0), flushed_pixels(0) {
+}
+
+////////////////////////////////////////////////////////////////////////////////
+SoftBackend::~SoftBackend() {
+  if(fb_map) munmap(fb_map, fb_map_size);
+  if(fb_fd >= 0) close(fb_fd);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool SoftBackend::open() {
+  screen.assign(BBT_SCREEN_WIDTH * BBT_SCREEN_HEIGHT, 0);
+  if(fb_device == NULL) return true;
+
+  fb_fd = ::open(fb_device, O_RDWR);
+  if(fb_fd < 0) {
+    printf("Failed to open %s: %s\n", fb_device, strerror(errno));
+    return false;
+  }
+
+  fb_fix_screeninfo fix;
+  fb_var_screeninfo var;
+  if(ioctl(fb_fd, FBIOGET_FSCREENINFO, &fix) < 0 || ioctl(fb_fd, FBIOGET_VSCREENINFO, &var) < 0) {
+    printf("%s is not a framebuffer: %s\n", fb_device, strerror(errno));
+    return false;
+  }
+
+  if(var.bits_per_pixel != 16 && var.bits_per_pixel != 32) {
+    printf("%s: %u bits per pixel is not supported\n", fb_device, var.bits_per_pixel);
+    return false;
+  }
+
+  // Portrait if it fits, else assume the landscape LCD cape and turn it
+  fb_rotate = var.xres < BBT_SCREEN_WIDTH || var.yres < BBT_SCREEN_HEIGHT;
+  if(fb_rotate && (var.xres < BBT_SCREEN_HEIGHT || var.yres < BBT_SCREEN_WIDTH)) {
+    printf("%s: %ux%u is too small\n", fb_device, var.xres, var.yres);
+    return false;
+  }
+
+  fb_map_size = fix.smem_len;
+  void * map = mmap(NULL, fb_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fb_fd, 0);
+  if(map == MAP_FAILED) {
+    printf("Failed to map %s: %s\n", fb_device, strerror(errno));
+    return false;
+  }
+
+  fb_map = (uint8_t *)map;
+  fb_pitch = fix.line_length;
+  fb_bytes = var.bits_per_pixel / 8;
+  fb_origin = fb_map + var.yoffset * fb_pitch + var.xoffset * fb_bytes;
+
+  const fb_bitfield * channels[3] = {&var.red, &var.green, &var.blue};
+  for(int i = 0; i < 3; i++) {
+    fb_shift[i] = channels[i]->offset;
+    fb_bits[i] = std::min(channels[i]->length, 8U);
+  }
+
+  for(unsigned int y = 0; y < var.yres; y++) {
+    memset(fb_origin + y * fb_pitch, 0, var.xres * fb_bytes);
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The atlas is converted to screen pixels once, so drawing is mostly copies
+bool SoftBackend::load(TextureAtlas & packed_atlas) {
+  if(!packed_atlas.pack(MAX_ATLAS_SIZE)) {
+    printf("Textures don't fit in a %dx%d atlas\n", MAX_ATLAS_SIZE, MAX_ATLAS_SIZE);
+    return false;
+  }
+
+  const uint8_t * rgba = packed_atlas.getPixels();
+  texels.resize(packed_atlas.getWidth() * packed_atlas.getHeight());
+  for(size_t i = 0; i < texels.size(); i++, rgba += 4) {
+    texels[i] = (uint32_t)rgba[0] << 16 | (uint32_t)rgba[1] << 8 | rgba[2];
+  }
+
+  atlas = &packed_atlas;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Blocks come in seven colors, so a short list per image is enough
+const SoftBackend::Tint & SoftBackend::getTint(AtlasId image, unsigned int rgb) {
+  if(image >= tints.size()) tints.resize(image + 1);
+
+  std::vector<Tint> & image_tints = tints[image];
+  for(const Tint & tint : image_tints) {
+    if(tint.rgb == rgb) return tint;
+  }
+
+  const int tex_width = atlas->getWidth(), tex_height = atlas->getHeight();
+  const AtlasRegion & region = atlas->getRegion(image);
+  int x0 = std::max(0, (int)lround(region.u0 * tex_width) - 1);
+  int y0 = std::max(0, (int)lround(region.v0 * tex_height) - 1);
+  int x1 = std::min(tex_width, (int)lround(region.u1 * tex_width) + 1);
+  int y1 = std::min(tex_height, (int)lround(region.v1 * tex_height) + 1);
+
+  Tint tint;
+  tint.rgb = rgb;
+  tint.x0 = x0;
+  tint.y0 = y0;
+  tint.width = x1 - x0;
+  tint.texels.reserve(area(x0, y0, x1, y1));
+
+  for(int y = y0; y < y1; y++) {
+    for(int x = x0; x < x1; x++) {
+      tint.texels.push_back(modulate(texels[y * tex_width + x], rgb));
+    }
+  }
+
+  image_tints.push_back(tint);
+  return image_tints.back();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Fills the pixels GL would: those with their center inside the quad, taking
+// the left and bottom edges but not the right and top ones. Texture
+// coordinates are stepped across and down in 16.16 fixed point, in texels,
+// sampled at the pixel centers like GL_LINEAR with clamping.
+void SoftBackend::add(AtlasId image, float x, float y, float w, float h,
+                      float s0, float t0, float s1, float t1, unsigned int rgb) {
+  quads++;
+
+  // Edges in pixels, rows counted from the top
+  double left = x * BBT_BLOCK_PIXELS, right = (x + w) * BBT_BLOCK_PIXELS;
+  double top = BBT_SCREEN_HEIGHT - (y + h) * BBT_BLOCK_PIXELS;
+  double bottom = BBT_SCREEN_HEIGHT - y * BBT_BLOCK_PIXELS;
+
+  Rect rect;
+  rect.x0 = std::max(0, (int)ceil(left - 0.5));
+  rect.x1 = std::min(BBT_SCREEN_WIDTH, (int)ceil(right - 0.5));
+  rect.y0 = std::max(0, (int)floor(top - 0.5) + 1);
+  rect.y1 = std::min(BBT_SCREEN_HEIGHT, (int)floor(bottom - 0.5) + 1);
+  if(rect.x0 >= rect.x1 || rect.y0 >= rect.y1) return;
+
+  // Texel coordinate of pixel center (px, py) is u_at + u_step * px
+  // across and v_at + v_step * py down
+  const int tex_width = atlas->getWidth(), tex_height = atlas->getHeight();
+  const AtlasRegion & region = atlas->getRegion(image);
+  double u_size = (region.u1 - region.u0) * tex_width;
+  double v_size = (region.v1 - region.v0) * tex_height;
+  double u_step = (s1 - s0) / (right - left) * u_size;
+  double v_step = -(t1 - t0) / (bottom - top) * v_size;
+  double u_at = region.u0 * tex_width + s0 * u_size + (0.5 - left) * u_step - 0.5;
+  double v_at = region.v0 * tex_height + t0 * v_size + (0.5 - bottom) * v_step - 0.5;
+
+  int32_t u_fixed = lround((u_at + u_step * rect.x0) * 65536.0);
+  int32_t du = lround(u_step * 65536.0);
+  int32_t v_fixed = lround((v_at + v_step * rect.y0) * 65536.0) + 0x80;
+  int32_t dv = lround(v_step * 65536.0);
+
+  // Whole texel steps starting on a texel center are a straight copy
+  bool copy_rows = du == 0x10000 && ((u_fixed + 0x80) & 0xFF00) == 0;
+  const Tint * tint = NULL;
+  if(copy_rows && rgb != 0 && rgb != 0xFFFFFF) tint = &getTint(image, rgb);
+
+  for(int py = rect.y0; py < rect.y1; py++, v_fixed += dv) {
+    uint32_t * out = &screen[py * BBT_SCREEN_WIDTH + rect.x0];
+    uint32_t * end = out + (rect.x1 - rect.x0);
+
+    if(rgb == 0) {
+      std::fill(out, end, 0);
+      continue;
+    }
+
+    int tv = std::min(std::max(v_fixed >> 16, 0), tex_height - 1);
+    int tv_next = std::min(tv + 1, tex_height - 1);
+    unsigned int fv = (v_fixed >> 8) & 0xFF;
+    const uint32_t * row = &texels[tv * tex_width];
+    const uint32_t * row_next = &texels[tv_next * tex_width];
+
+    if(copy_rows && fv == 0) {
+      int tu = (u_fixed + 0x80) >> 16;
+      const uint32_t * in = row + tu;
+      int tint_x = tint ? tu - tint->x0 : 0, tint_y = tint ? tv - tint->y0 : 0;
+
+      if(rgb == 0xFFFFFF) {
+        std::copy(in, in + (end - out), out);
+      } else if(tint && tint_x >= 0 && tint_x + (end - out) <= tint->width &&
+                tint_y >= 0 && (size_t)((tint_y + 1) * tint->width) <= tint->texels.size()) {
+        in = &tint->texels[tint_y * tint->width + tint_x];
+        std::copy(in, in + (end - out), out);
+      } else {
+        // Reaching outside the image
+        for(; out < end; out++, in++) *out = modulate(*in, rgb);
+      }
+      continue;
+    }
+
+    for(int32_t u = u_fixed + 0x80; out < end; out++, u += du) {
+      int tu = std::min(std::max(u >> 16, 0), tex_width - 1);
+      int tu_next = std::min(tu + 1, tex_width - 1);
+      unsigned int fu = (u >> 8) & 0xFF;
+
+      uint32_t pixel = lerpPixel(lerpPixel(row[tu], row[tu_next], fu),
+                                 lerpPixel(row_next[tu], row_next[tu_next], fu), fv);
+      *out = rgb == 0xFFFFFF ? pixel : modulate(pixel, rgb);
+    }
+  }
+
+  addDirty(rect);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Merge into the last rectangle while that covers no more than both did, so
+// the parts of a block and the blocks along a row become one rectangle
+void SoftBackend::addDirty(const Rect & rect) {
+  if(!dirty.empty()) {
+    Rect & last = dirty.back();
+    Rect both = {std::min(last.x0, rect.x0), std::min(last.y0, rect.y0),
+                 std::max(last.x1, rect.x1), std::max(last.y1, rect.y1)};
+
+    if(area(both.x0, both.y0, both.x1, both.y1) <=
+       area(last.x0, last.y0, last.x1, last.y1) + area(rect.x0, rect.y0, rect.x1, rect.y1)) {
+      last = both;
+      return;
+    }
+  }
+
+  // Too scattered to be worth tracking: one rectangle around all of it
+  if(dirty.size() == MAX_DIRTY) {
+    Rect all = rect;
+    for(const Rect & r : dirty) {
+      all.x0 = std::min(all.x0, r.x0);
+      all.y0 = std::min(all.y0, r.y0);
+      all.x1 = std::max(all.x1, r.x1);
+      all.y1 = std::max(all.y1, r.y1);
+    }
+    dirty.assign(1, all);
+    return;
+  }
+
+  dirty.push_back(rect);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void SoftBackend::flush() {
+  last_flush.quads = quads;
+  last_flush.calls = fb_origin ? dirty.size() : 0;
+  quads = 0;
+
+  for(const Rect & rect : dirty) {
+    if(fb_origin) present(rect);
+    flushed_pixels += area(rect.x0, rect.y0, rect.x1, rect.y1);
+  }
+  dirty.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Copy a rectangle of the frame to the framebuffer in its pixel format. When
+// turned, the top of the frame is on the right of the screen.
+void SoftBackend::present(const Rect & rect) {
+  for(int y = rect.y0; y < rect.y1; y++) {
+    const uint32_t * in = &screen[y * BBT_SCREEN_WIDTH];
+
+    for(int x = rect.x0; x < rect.x1; x++) {
+      int fx = fb_rotate ? BBT_SCREEN_HEIGHT - 1 - y : x;
+      int fy = fb_rotate ? x : y;
+      uint8_t * out = fb_origin + fy * fb_pitch + fx * fb_bytes;
+
+      uint32_t pixel = in[x];
+      uint32_t value = (pixel >> 16 & 0xFF) >> (8 - fb_bits[0]) << fb_shift[0] |
+                       (pixel >> 8 & 0xFF) >> (8 - fb_bits[1]) << fb_shift[1] |
+                       (pixel & 0xFF) >> (8 - fb_bits[2]) << fb_shift[2];
+
+      if(fb_bytes == 2) {
+        *(uint16_t *)out = value;
+      } else {
+        *(uint32_t *)out = value;
+      }
+    }
+  }
+}
@@ -0,0 +1,80 @@
+#ifndef SOFT_BACKEND_H
+#define SOFT_BACKEND_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "RenderBackend.hpp"
+#include "TextureAtlas.hpp"
+
+// Draws on the CPU into a BBT_SCREEN_WIDTH by BBT_SCREEN_HEIGHT buffer, with
+// no X server or GL. Quads are composited from the atlas, converted once to
+// screen pixels, as soon as they are added: straight copies where a texel
+// lands on a pixel, which is every block and digit at full size, and
+// bilinear filtered otherwise, so the result matches the GL path to a level
+// or two. Colored copies come from the image tinted once, on first use.
+// Flushing copies only the rectangles drawn since the last flush to a Linux
+// framebuffer, or leaves the frame in memory for tests and benchmarks.
+class SoftBackend : public RenderBackend {
+public:
+  // Draw into memory only, or also show every flush on a framebuffer device
+  // such as /dev/fb0
+  explicit SoftBackend(const char * fb_device = NULL);
+  ~SoftBackend();
+
+  // Map the framebuffer and clear it. A landscape screen shows the frame
+  // turned as the GL path does.
+  bool open();
+
+  bool load(TextureAtlas & atlas);
+
+  void add(AtlasId image, float x, float y, float w, float h,
+           float s0, float t0, float s1, float t1, unsigned int rgb);
+
+  bool empty() const { return dirty.empty(); }
+
+  // Copy what changed to the framebuffer, if there is one
+  void flush();
+
+  // The frame as drawn so far, 0x00RRGGBB, rows from the top of the screen
+  const uint32_t * getPixels() const { return screen.data(); }
+
+  // Screen area copied by flushes so far, in pixels
+  uint64_t getFlushedPixels() const { return flushed_pixels; }
+
+private:
+  struct Rect {
+    int x0, y0, x1, y1;   // pixels x0 <= x < x1, y0 <= y < y1
+  };
+
+  // An image multiplied by one color, with its border, so that copying it
+  // needs no multiplies
+  struct Tint {
+    unsigned int rgb;
+    int x0, y0, width;    // where it is in the atlas, texels per row
+    std::vector<uint32_t> texels;
+  };
+
+  const Tint & getTint(AtlasId image, unsigned int rgb);
+  void addDirty(const Rect & rect);
+  void present(const Rect & rect);
+
+  const char * fb_device;
+  int fb_fd;
+  uint8_t * fb_map;
+  size_t fb_map_size;
+  uint8_t * fb_origin;   // first visible pixel
+  int fb_pitch, fb_bytes;
+  bool fb_rotate;
+  int fb_shift[3], fb_bits[3];  // red, green, blue
+
+  const TextureAtlas * atlas;
+  std::vector<uint32_t> texels;
+  std::vector<std::vector<Tint> > tints;   // by image, made on first use
+  std::vector<uint32_t> screen;
+  std::vector<Rect> dirty;
+  unsigned int quads;     // added since the last flush
+  uint64_t flushed_pixels;
+};
+
+#endif
@@ -0,0 +1,54 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the SpscRing class: a fixed size queue between one writer
+/// thread and one reader thread that never blocks or allocates.
+///
+/// Entries are filled and read in place. The writer claims a free slot,
+/// fills it and pushes it; the reader peeks at the oldest pushed slot and
+/// pops it once done. Each index is only written by its own side.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+template <typename T, uint32_t N>
+class SpscRing {
+  static_assert((N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+  SpscRing() : head(0), tail(0) {}
+
+  // Writer side: the slot to fill, or NULL if the reader has not caught up
+  T * claim() {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if(h - tail.load(std::memory_order_acquire) == N) return NULL;
+    return &slots[h & (N - 1)];
+  }
+
+  // Writer side: hand the claimed slot to the reader
+  void push() {
+    head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // Reader side: the oldest pushed slot, or NULL if there is none
+  const T * peek() const {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if(t == head.load(std::memory_order_acquire)) return NULL;
+    return &slots[t & (N - 1)];
+  }
+
+  // Reader side: give the peeked slot back to the writer
+  void pop() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+private:
+  T slots[N];
+  std::atomic<uint32_t> head;  // written by the writer only
+  std::atomic<uint32_t> tail;  // written by the reader only
+};
+
+#endif
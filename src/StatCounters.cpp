@@ -0,0 +1,82 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "StatCounters.hpp"
+
+// Zeroed like a new segment, as a static
+static StatCounters private_counters;
+StatCounters * stat_counters = &private_counters;
+
+////////////////////////////////////////////////////////////////////////////////
+// Fill in the header of a segment that is all zeros
+static void initialize(StatCounters * counters) {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  counters->version = BBT_STAT_VERSION;
+  counters->size = sizeof(StatCounters);
+  counters->pid = getpid();
+  counters->start_ns = (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+
+  // Published last, so a reader that sees the magic sees the rest
+  counters->magic.store(BBT_STAT_MAGIC, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// A new segment every run. One left by an earlier run may still be mapped
+// by a bbt_stat, so it is never rewritten, only unlinked.
+bool openStatCounters() {
+  shm_unlink(BBT_STAT_NAME);
+  int fd = shm_open(BBT_STAT_NAME, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if(fd < 0) {
+    printf("Failed to create shared memory %s, counters stay private\n", BBT_STAT_NAME);
+    return false;
+  }
+
+  void * map = MAP_FAILED;
+  if(ftruncate(fd, sizeof(StatCounters)) == 0) {
+    map = mmap(NULL, sizeof(StatCounters), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+
+  if(map == MAP_FAILED) {
+    printf("Failed to map shared memory %s, counters stay private\n", BBT_STAT_NAME);
+    return false;
+  }
+
+  // Zero filled by the kernel
+  StatCounters * shared = (StatCounters *)map;
+  initialize(shared);
+  stat_counters = shared;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void unlinkStatCounters() {
+  if(stat_counters != &private_counters) shm_unlink(BBT_STAT_NAME);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const StatCounters * attachStatCounters() {
+  int fd = shm_open(BBT_STAT_NAME, O_RDONLY, 0);
+  if(fd < 0) return NULL;
+
+  struct stat info;
+  void * map = MAP_FAILED;
+  if(fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(StatCounters)) {
+    map = mmap(NULL, sizeof(StatCounters), PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if(map == MAP_FAILED) return NULL;
+
+  const StatCounters * counters = (const StatCounters *)map;
+  if(counters->magic.load(std::memory_order_acquire) != BBT_STAT_MAGIC || counters->version < BBT_STAT_VERSION ||
+     counters->size < sizeof(StatCounters)) {
+    munmap(map, sizeof(StatCounters));
+    return NULL;
+  }
+  return counters;
+}
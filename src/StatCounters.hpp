@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the StatCounters shared memory segment: totals and gauges the
+/// running bbt keeps in /dev/shm for bbt_stat, or anything else that maps it,
+/// to read without stopping or attaching to it. Every field is a 64 bit
+/// atomic updated with relaxed stores or adds by the thread that owns it, so
+/// keeping them costs a few uncontended adds per tick and per frame. Readers
+/// take differences between two samples to get rates.
+///
+/// The layout is fixed: fields are only ever added at the end, and version
+/// changes when that happens, so an older reader can still check what it
+/// understands.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef STAT_COUNTERS_H
+#define STAT_COUNTERS_H
+
+#include <atomic>
+#include <cstdint>
+
+#define BBT_STAT_NAME "/bbt_stats"
+#define BBT_STAT_MAGIC 0x54415453544242ULL   // "BBTSTAT"
+#define BBT_STAT_VERSION 2
+
+typedef std::atomic<uint64_t> StatCounter;
+
+struct StatCounters {
+  std::atomic<uint64_t> magic;   // set last, once the header is filled in
+  uint32_t version;
+  uint32_t size;            // of this struct, in bytes
+  uint64_t pid;
+  uint64_t start_ns;        // CLOCK_MONOTONIC when bbt started
+
+  // Controller thread
+  StatCounter ticks;
+  StatCounter tick_run_ns;      // total time in processTick
+  StatCounter missed_periods;   // deadlines passed without a tick
+  StatCounter events_consumed;
+  StatCounter events_dropped;   // by the input ring when full
+  StatCounter deltas_deferred;  // change records held back, the ring was full
+  StatCounter pieces_locked;
+  StatCounter lines_cleared;
+  StatCounter line_clears[4];   // ticks that cleared 1, 2, 3 and 4 lines
+
+  // Display thread
+  StatCounter frames_drawn;
+  StatCounter frames_skipped;   // woke up to new state that looked the same
+  StatCounter resyncs;          // started over from the full state
+  StatCounter blocks_redrawn;
+  StatCounter flush_ns;         // total time in the backend's flush and swap
+
+  // Gauges, the latest value
+  StatCounter score;
+  StatCounter level;
+
+  // Version 2
+  StatCounter journal_lost;     // records the journal dropped, its writer was behind
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "StatCounters need lock free 64 bit atomics to be shared");
+
+// Create the segment, replacing one left by an earlier run, and point
+// stat_counters at it. Call before any thread starts: until then, or if it
+// fails, stat_counters points to a private copy, so updating never needs
+// checks, but nothing counted there shows up in the segment. A reader of an
+// earlier run's segment keeps it mapped and has to attach again.
+bool openStatCounters();
+
+// Remove the segment's name, leaving the mapping for this process
+void unlinkStatCounters();
+
+// Map a running bbt's segment read-only. Returns NULL if there is none or it
+// is older than this version.
+const StatCounters * attachStatCounters();
+
+extern StatCounters * stat_counters;
+
+#endif
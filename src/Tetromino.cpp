@@ -1,46 +1,103 @@
+#include <cstddef>
 #include <stdexcept>
 #include "Tetromino.hpp"
 
 static BlockData empty_block = BlockData(0, 0);
 
-// All rotation states for all tetromino types
-int Tetromino::values[BlockData::num_colors][height][num_rotations][width] = {
-  {
-    {{0,0,0,0}, {0,0,1,0}, {0,0,0,0}, {0,0,1,0}},
-    {{1,1,1,1}, {0,0,1,0}, {1,1,1,1}, {0,0,1,0}},
-    {{0,0,0,0}, {0,0,1,0}, {0,0,0,0}, {0,0,1,0}},
-    {{0,0,0,0}, {0,0,1,0}, {0,0,0,0}, {0,0,1,0}},
-  }, {
-    {{0,0,0,0}, {0,0,0,0}, {0,0,0,0}, {0,0,0,0}},
-    {{1,1,1,0}, {0,1,0,0}, {0,1,0,0}, {0,1,0,0}},
-    {{0,1,0,0}, {0,1,1,0}, {1,1,1,0}, {1,1,0,0}},
-    {{0,0,0,0}, {0,1,0,0}, {0,0,0,0}, {0,1,0,0}},
-  }, {
-    {{0,0,0,0}, {0,0,0,0}, {0,0,0,0}, {0,0,0,0}},
-    {{1,1,0,0}, {1,1,0,0}, {1,1,0,0}, {1,1,0,0}},
-    {{1,1,0,0}, {1,1,0,0}, {1,1,0,0}, {1,1,0,0}},
-    {{0,0,0,0}, {0,0,0,0}, {0,0,0,0}, {0,0,0,0}},
-  }, {
-    {{0,0,0,0}, {0,0,0,0}, {0,0,0,0}, {0,0,0,0}},
-    {{1,1,1,0}, {1,1,0,0}, {0,0,1,0}, {1,0,0,0}},
-    {{1,0,0,0}, {0,1,0,0}, {1,1,1,0}, {1,0,0,0}},
-    {{0,0,0,0}, {0,1,0,0}, {0,0,0,0}, {1,1,0,0}},
-  }, {
-    {{0,0,0,0}, {0,0,0,0}, {0,0,0,0}, {0,0,0,0}},
-    {{1,0,0,0}, {1,1,0,0}, {1,1,1,0}, {0,1,0,0}},
-    {{1,1,1,0}, {1,0,0,0}, {0,0,1,0}, {0,1,0,0}},
-    {{0,0,0,0}, {1,0,0,0}, {0,0,0,0}, {1,1,0,0}},
-  }, {
-    {{0,0,0,0}, {0,0,0,0}, {0,0,0,0}, {0,0,0,0}},
-    {{1,1,0,0}, {0,1,0,0}, {1,1,0,0}, {0,1,0,0}},
-    {{0,1,1,0}, {1,1,0,0}, {0,1,1,0}, {1,1,0,0}},
-    {{0,0,0,0}, {1,0,0,0}, {0,0,0,0}, {1,0,0,0}},
-  }, {
-    {{0,0,0,0}, {0,0,0,0}, {0,0,0,0}, {0,0,0,0}},
-    {{0,1,1,0}, {1,0,0,0}, {0,1,1,0}, {1,0,0,0}},
-    {{1,1,0,0}, {1,1,0,0}, {1,1,0,0}, {1,1,0,0}},
-    {{0,0,0,0}, {0,1,0,0}, {0,0,0,0}, {0,1,0,0}},
-  }
+// Canonical shape of every tetromino type at rotation 0, as (x, y) cells
+// within the 4x4 piece area, y pointing up
+static constexpr int shapes[BlockData::num_colors][Tetromino::num_cells][2] = {
+  {{0, 2}, {1, 2}, {2, 2}, {3, 2}}, // I
+  {{0, 2}, {1, 2}, {2, 2}, {1, 1}}, // T
+  {{0, 1}, {1, 1}, {0, 2}, {1, 2}}, // O
+  {{0, 2}, {1, 2}, {2, 2}, {0, 1}}, // L
+  {{0, 1}, {1, 1}, {2, 1}, {0, 2}}, // J
+  {{0, 2}, {1, 2}, {1, 1}, {2, 1}}, // S
+  {{0, 1}, {1, 1}, {1, 2}, {2, 2}}, // Z
+};
+
+// Offset applied after turning the canonical shape clockwise about the
+// origin, by number of quarter turns, which brings every turn back into the
+// 4x4 piece area
+static constexpr int anchors[BlockData::num_colors][Tetromino::num_rotations][2] = {
+  {{0, 0}, {0, 3}, {3, 4}, {4, 0}}, // I
+  {{0, 0}, {-1, 2}, {2, 3}, {3, 0}}, // T
+  {{0, 0}, {-1, 2}, {1, 3}, {2, 1}}, // O
+  {{0, 0}, {-1, 2}, {2, 3}, {2, 0}}, // L
+  {{0, 0}, {-1, 2}, {2, 3}, {2, 0}}, // J
+  {{0, 0}, {-1, 2}, {2, 3}, {2, 0}}, // S
+  {{0, 0}, {-1, 2}, {2, 3}, {2, 0}}, // Z
+};
+
+// Clockwise quarter turns of each rotation state. T's rotations 1 and 3
+// have always been the other way round, and journals replay with them.
+static constexpr int turns[BlockData::num_colors][Tetromino::num_rotations] = {
+  {0, 1, 2, 3}, // I
+  {0, 3, 2, 1}, // T
+  {0, 1, 2, 3}, // O
+  {0, 1, 2, 3}, // L
+  {0, 1, 2, 3}, // J
+  {0, 1, 2, 3}, // S
+  {0, 1, 2, 3}, // Z
+};
+
+// Position of cell i of piece p after t clockwise quarter turns
+static constexpr int turnedX(int p, int t, int i) {
+  return anchors[p][t][0] + (t == 0 ?  shapes[p][i][0] :
+                             t == 1 ?  shapes[p][i][1] :
+                             t == 2 ? -shapes[p][i][0] :
+                                      -shapes[p][i][1]);
+}
+
+static constexpr int turnedY(int p, int t, int i) {
+  return anchors[p][t][1] + (t == 0 ?  shapes[p][i][1] :
+                             t == 1 ? -shapes[p][i][0] :
+                             t == 2 ? -shapes[p][i][1] :
+                                       shapes[p][i][0]);
+}
+
+// Position of cell i of piece p in rotation state r
+static constexpr int cellX(int p, int r, int i) {
+  return turnedX(p, turns[p][r], i);
+}
+
+static constexpr int cellY(int p, int r, int i) {
+  return turnedY(p, turns[p][r], i);
+}
+
+static constexpr uint8_t cellBit(int p, int r, int i, int y) {
+  return cellY(p, r, i) == y ? 1 << cellX(p, r, i) : 0;
+}
+
+static constexpr uint8_t rowMask(int p, int r, int y) {
+  return cellBit(p, r, 0, y) | cellBit(p, r, 1, y) |
+         cellBit(p, r, 2, y) | cellBit(p, r, 3, y);
+}
+
+static_assert(rowMask(0, 0, 2) == 0x0F && rowMask(0, 1, 0) == 0x04,
+              "I piece shape generation is broken");
+
+#define BBT_ROW_MASKS(p, r) \
+  { rowMask(p, r, 0), rowMask(p, r, 1), rowMask(p, r, 2), rowMask(p, r, 3) }
+#define BBT_ROTATION_MASKS(p) \
+  { BBT_ROW_MASKS(p, 0), BBT_ROW_MASKS(p, 1), BBT_ROW_MASKS(p, 2), BBT_ROW_MASKS(p, 3) }
+
+#define BBT_CELL(p, r, i) { cellX(p, r, i), cellY(p, r, i) }
+#define BBT_CELLS(p, r) \
+  { BBT_CELL(p, r, 0), BBT_CELL(p, r, 1), BBT_CELL(p, r, 2), BBT_CELL(p, r, 3) }
+#define BBT_ROTATION_CELLS(p) \
+  { BBT_CELLS(p, 0), BBT_CELLS(p, 1), BBT_CELLS(p, 2), BBT_CELLS(p, 3) }
+
+const uint8_t Tetromino::masks[BlockData::num_colors][num_rotations][height] = {
+  BBT_ROTATION_MASKS(0), BBT_ROTATION_MASKS(1), BBT_ROTATION_MASKS(2),
+  BBT_ROTATION_MASKS(3), BBT_ROTATION_MASKS(4), BBT_ROTATION_MASKS(5),
+  BBT_ROTATION_MASKS(6)
+};
+
+const Tetromino::Cell Tetromino::cells[BlockData::num_colors][num_rotations][num_cells] = {
+  BBT_ROTATION_CELLS(0), BBT_ROTATION_CELLS(1), BBT_ROTATION_CELLS(2),
+  BBT_ROTATION_CELLS(3), BBT_ROTATION_CELLS(4), BBT_ROTATION_CELLS(5),
+  BBT_ROTATION_CELLS(6)
 };
 
 std::array<std::pair<float, float>, BlockData::num_colors> Tetromino::centers = {
@@ -48,25 +105,34 @@ std::array<std::pair<float, float>, BlockData::num_colors> Tetromino::centers =
 };
 
 ////////////////////////////////////////////////////////////////////////////////
-Tetromino::Tetromino() {
-  reinitialize();
+/// \brief An empty piece at the spawn position, call reinitialize to get a
+///        real one
+Tetromino::Tetromino() : block_data(0, 0) {
+  pos_x = BOARD_WIDTH / 2;
+  pos_y = BOARD_HEIGHT - 3;
+  pos_rotation = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
+/// \brief Checked lookup of a single cell of a piece type, for debugging
+/// \throws std::out_of_range on an invalid rotation or position
 bool Tetromino::getValue(int color, int rotation, int x, int y) {
   if(rotation < 0 || rotation >= num_rotations) throw std::out_of_range("rotation");
-  if(x < 0 || x > width)                        throw std::out_of_range("x");
-  if(y < 0 || y > height)                       throw std::out_of_range("y");
+  if(x < 0 || x >= width)                        throw std::out_of_range("x");
+  if(y < 0 || y >= height)                       throw std::out_of_range("y");
 
   if(color < 1 || color > BlockData::num_colors) return false;
 
-  return values[color - 1][height - 1 - y][rotation][x] != 0;
+  return (masks[color - 1][rotation][y] >> x) & 1;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 /// \brief Get BlockData for a particular subposition of this tetromino
+///        (0 <= x < width, 0 <= y < height)
 BlockData Tetromino::getBlock(int x, int y) const {
-  return getValue(block_data.color, pos_rotation, x, y) ? block_data : empty_block;
+  if(block_data.color < 1 || block_data.color > BlockData::num_colors) return empty_block;
+
+  return (masks[block_data.color - 1][pos_rotation][y] >> x) & 1 ? block_data : empty_block;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -79,19 +145,10 @@ void Tetromino::move(int dx, int dy, int dr) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-/// \brief Reinitialize our block data to a new random block at rotation 0
-void Tetromino::reinitialize() {
-  static bool rand_initialized = false;
-
-  if(!rand_initialized) {
-    time_t t;
-    srandom(time(&t));
-
-    rand_initialized = true;
-  }
-
-  block_data.id = random();
-  block_data.color = (block_data.id % BlockData::num_colors) + 1;
+/// \brief Reinitialize our block data to the generator's next block at
+///        rotation 0
+void Tetromino::reinitialize(PieceGenerator & generator) {
+  block_data = generator.nextPiece();
 
   pos_x = BOARD_WIDTH / 2;
   pos_y = BOARD_HEIGHT - 3;
@@ -101,30 +158,41 @@ void Tetromino::reinitialize() {
 ////////////////////////////////////////////////////////////////////////////////
 /// \brief Determine if a movement would result in an intersection with a block
 ///        on the board.
-bool Tetromino::wouldIntersect(BoardState & board, int dx, int dy, int dr) {
-  for(int x = 0; x < width; x++) {
-    for(int y = 0; y < height; y++) {
-      int new_rot = (pos_rotation + dr + num_rotations) % num_rotations;
-      bool on_block = getValue(block_data.color, new_rot, x, y);
+///
+/// Each piece row is shifted into a 32 bit word with width bits of slack on
+/// the right so that positions left of the board do not need a signed shift.
+/// Everything outside of the board columns is treated as wall.
+bool Tetromino::wouldIntersect(const BoardState & board, int dx, int dy, int dr) const {
+  static const uint32_t walls = ~((uint32_t)FULL_ROW_MASK << width);
+
+  if(block_data.color < 1 || block_data.color > BlockData::num_colors) return false;
 
-      if(!on_block) continue;
+  int new_rot = (pos_rotation + dr + num_rotations) % num_rotations;
+  int new_x = pos_x + dx;
+  int new_y = pos_y + dy;
 
-      // Apply offset and check ranges
-      int new_x = pos_x + dx + x;
-      int new_y = pos_y + dy + y;
+  // Entirely off the left side of the board
+  if(new_x <= -width) return true;
 
-      if(new_x < 0 || new_x >= (signed)board.size()) return true;
-      if(new_y < 0) return true;
+  const uint8_t * piece = masks[block_data.color - 1][new_rot];
 
-      // Allow to live off of the top end of the board
-      if(new_y >= (signed)board[new_x].size()) continue;
+  for(int y = 0; y < height; y++) {
+    if(piece[y] == 0) continue;
 
-      bool on_board = board[new_x][new_y].color != 0;
+    uint32_t row = (uint32_t)piece[y] << (new_x + width);
+    int board_y = new_y + y;
 
-      if(on_board) return true;
+    if(board_y < 0) return true;
+
+    // Allow to live off of the top end of the board
+    if(board_y >= BOARD_HEIGHT) {
+      if(row & walls) return true;
+      continue;
     }
+
+    if(row & (walls | ((uint32_t)board.getRow(board_y) << width))) return true;
   }
-  
+
   return false;
 }
 
@@ -139,20 +207,30 @@ bool Tetromino::tryMove(BoardState & board, int dx, int dy, int dr) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-/// \brief Place this tetromino on the board at its current location
-void Tetromino::place(BoardState & board) {
-  for(int x = 0; x < width; x++) {
-    for(int y = 0; y < height; y++) {
-      bool on_block = getValue(block_data.color, pos_rotation, x, y);
-
-      if(!on_block) continue;
-
-      int new_x = pos_x + x;
-      int new_y = pos_y + y;
-      if(new_x < 0 || new_x >= (signed)board.size()) continue;
-      if(new_y < 0 || new_y >= (signed)board[new_x].size()) continue;
+/// \brief Cells of the current rotation, relative to pos_x and pos_y
+/// \returns num_cells cells, or NULL for an empty piece
+const Tetromino::Cell * Tetromino::getCells() const {
+  if(block_data.color < 1 || block_data.color > BlockData::num_colors) return NULL;
+  return cells[block_data.color - 1][pos_rotation];
+}
 
-      board[new_x][new_y] = block_data;
-    }
+////////////////////////////////////////////////////////////////////////////////
+/// \brief Place this tetromino on the board at its current location
+/// \returns The rows that were written to
+RowSet Tetromino::place(BoardState & board) const {
+  RowSet touched = 0;
+  const Cell * piece = getCells();
+  if(piece == NULL) return touched;
+
+  for(int i = 0; i < num_cells; i++) {
+    int new_x = pos_x + piece[i].x;
+    int new_y = pos_y + piece[i].y;
+    if(new_x < 0 || new_x >= BOARD_WIDTH) continue;
+    if(new_y < 0 || new_y >= BOARD_HEIGHT) continue;
+
+    board.set(new_x, new_y, block_data);
+    touched |= 1u << new_y;
   }
+
+  return touched;
 }
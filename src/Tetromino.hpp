@@ -3,18 +3,32 @@
 
 #include <utility>
 #include <array>
+#include <cstdint>
 #include "BBTdefines.hpp"
+#include "BoardState.hpp"
+#include "PieceGenerator.hpp"
 
 class Tetromino {
 public:
   static const int num_rotations = 4;
   static const int width = 4;
   static const int height = 4;
+  static const int num_cells = 4;
+
+  struct Cell {
+    int8_t x, y;
+  };
+
+  static bool getValue(int block, int rotation, int x, int y);
 
 private:
-  static int values[BlockData::num_colors][height][num_rotations][width];
   static std::array<std::pair<float, float>, BlockData::num_colors> centers;
-  static bool getValue(int block, int rotation, int x, int y);
+
+  // Generated at compile time from one canonical shape per piece type.
+  // Bit x of masks[..][..][y] is set if (x, y) is part of the piece, cells
+  // lists the same positions.
+  static const uint8_t masks[BlockData::num_colors][num_rotations][height];
+  static const Cell cells[BlockData::num_colors][num_rotations][num_cells];
 
   BlockData block_data;
 
@@ -25,24 +39,31 @@ public:
   Tetromino();
 
   BlockData getBlock(int x, int y) const;
+  const Cell * getCells() const;
 
   void move(int dx, int dy, int dr = 0);
-  void reinitialize();
-  bool wouldIntersect(BoardState & board, int dx, int dy, int dr);
+  void reinitialize(PieceGenerator & generator);
+  bool wouldIntersect(const BoardState & board, int dx, int dy, int dr) const;
   bool tryMove(BoardState & board, int dx, int dy, int dr);
-  void place(BoardState & board);
+  RowSet place(BoardState & board) const;
 
-  std::pair<float, float> getCenter() {
+  std::pair<float, float> getCenter() const {
     return centers.at(block_data.color - 1);
   }
 
-  bool operator==(const Tetromino & t) {
+  bool operator==(const Tetromino & t) const {
     return block_data == t.block_data;
   }
 
-  bool operator!=(const Tetromino & t) {
+  bool operator!=(const Tetromino & t) const {
     return !operator==(t);
   }
+
+  // Same piece at the same position and rotation
+  bool samePose(const Tetromino & t) const {
+    return block_data == t.block_data && pos_x == t.pos_x &&
+           pos_y == t.pos_y && pos_rotation == t.pos_rotation;
+  }
 };
 
 #endif
@@ -0,0 +1,314 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstring>
+#include "TextureAtlas.hpp"
+
+static const int BORDER = 1;
+
+#define BUNDLE_MAGIC "BBTA"
+#define BUNDLE_VERSION 1
+#define BUNDLE_MARKER 0x01020304
+#define BUNDLE_NAME_SIZE 32
+#define BUNDLE_ALIGN 4096
+
+struct BundleHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t marker;
+  uint32_t width, height;
+  uint32_t image_count;
+  uint32_t pixel_offset;
+};
+
+struct BundleEntry {
+  char name[BUNDLE_NAME_SIZE];
+  int32_t x, y, width, height;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static int nextPowerOfTwo(int n) {
+  int p = 1;
+  while(p < n) p <<= 1;
+  return p;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TextureAtlas::TextureAtlas() : packed(NULL), width(0), height(0), mapping(NULL), mapping_size(0) {
+  clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TextureAtlas::~TextureAtlas() {
+  unmap();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TextureAtlas::unmap() {
+  if(mapping) munmap(mapping, mapping_size);
+  mapping = NULL;
+  mapping_size = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TextureAtlas::clear() {
+  static const uint8_t white[4 * 4 * 4] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255 };
+
+  unmap();
+  images.clear();
+  regions.clear();
+  std::vector<uint8_t>().swap(pixels);
+  packed = NULL;
+  width = height = 0;
+
+  add(white, 4, 4, 4 * 4);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AtlasId TextureAtlas::add(const uint8_t * rgba, int image_width, int image_height, int pitch,
+                          const std::string & name) {
+  Image image;
+  image.name = name;
+  image.width = image_width;
+  image.height = image_height;
+  image.x = image.y = 0;
+  image.rgba.resize(image_width * image_height * 4);
+
+  for(int y = 0; y < image_height; y++) {
+    memcpy(&image.rgba[y * image_width * 4], rgba + y * pitch, image_width * 4);
+  }
+
+  images.push_back(image);
+  regions.push_back(AtlasRegion());
+  return images.size() - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+AtlasId TextureAtlas::find(const std::string & name) const {
+  for(unsigned int i = 0; i < images.size(); i++) {
+    if(images[i].name == name) return i;
+  }
+  return NOT_FOUND;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void TextureAtlas::setRegion(AtlasId id) {
+  const Image & image = images[id];
+  AtlasRegion & region = regions[id];
+  region.u0 = (float)image.x / width;
+  region.v0 = (float)image.y / height;
+  region.u1 = (float)(image.x + image.width) / width;
+  region.v1 = (float)(image.y + image.height) / height;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Tallest images first, left to right along shelves as high as their first
+// image. Every width that could hold the widest image is tried, and the one
+// giving the smallest atlas wins.
+bool TextureAtlas::pack(int max_size) {
+  if(width != 0) return width <= max_size && height <= max_size;
+
+  std::vector<int> order(images.size());
+  int widest = 0;
+
+  for(unsigned int i = 0; i < images.size(); i++) {
+    order[i] = i;
+    widest = std::max(widest, images[i].width + 2 * BORDER);
+  }
+
+  std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+    return images[a].height > images[b].height;
+  });
+
+  int best_width = 0, best_height = 0;
+  for(int try_width = nextPowerOfTwo(widest); try_width <= max_size; try_width <<= 1) {
+    int x = 0, shelf_y = 0, shelf_height = 0;
+
+    for(int i : order) {
+      int w = images[i].width + 2 * BORDER;
+      int h = images[i].height + 2 * BORDER;
+
+      if(x + w > try_width) {
+        shelf_y += shelf_height;
+        x = shelf_height = 0;
+      }
+
+      x += w;
+      shelf_height = std::max(shelf_height, h);
+    }
+
+    int try_height = nextPowerOfTwo(shelf_y + shelf_height);
+    if(try_height <= max_size &&
+       (best_width == 0 || try_width * try_height < best_width * best_height)) {
+      best_width = try_width;
+      best_height = try_height;
+    }
+  }
+
+  if(best_width == 0) return false;
+
+  width = best_width;
+  height = best_height;
+  pixels.assign(width * height * 4, 0);
+
+  // Same walk again, this time copying the images and their borders in
+  int x = 0, shelf_y = 0, shelf_height = 0;
+  for(int i : order) {
+    Image & image = images[i];
+    int w = image.width + 2 * BORDER;
+    int h = image.height + 2 * BORDER;
+
+    if(x + w > width) {
+      shelf_y += shelf_height;
+      x = shelf_height = 0;
+    }
+
+    image.x = x + BORDER;
+    image.y = shelf_y + BORDER;
+
+    for(int row = -BORDER; row < image.height + BORDER; row++) {
+      int src_row = std::min(std::max(row, 0), image.height - 1);
+
+      for(int col = -BORDER; col < image.width + BORDER; col++) {
+        int src_col = std::min(std::max(col, 0), image.width - 1);
+        memcpy(&pixels[((image.y + row) * width + image.x + col) * 4],
+               &image.rgba[(src_row * image.width + src_col) * 4], 4);
+      }
+    }
+
+    // Only the packed copy is needed from here on
+    std::vector<uint8_t>().swap(image.rgba);
+
+    setRegion(i);
+
+    x += w;
+    shelf_height = std::max(shelf_height, h);
+  }
+
+  packed = pixels.data();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool TextureAtlas::save(const char * file) const {
+  if(packed == NULL) {
+    printf("Atlas has to be packed before saving %s\n", file);
+    return false;
+  }
+
+  BundleHeader header;
+  memcpy(header.magic, BUNDLE_MAGIC, sizeof(header.magic));
+  header.version = BUNDLE_VERSION;
+  header.marker = BUNDLE_MARKER;
+  header.width = width;
+  header.height = height;
+  header.image_count = images.size();
+
+  size_t index_end = sizeof(header) + images.size() * sizeof(BundleEntry);
+  header.pixel_offset = (index_end + BUNDLE_ALIGN - 1) / BUNDLE_ALIGN * BUNDLE_ALIGN;
+
+  std::vector<uint8_t> head(header.pixel_offset, 0);
+  memcpy(&head[0], &header, sizeof(header));
+
+  for(unsigned int i = 0; i < images.size(); i++) {
+    const Image & image = images[i];
+    if(image.name.size() >= BUNDLE_NAME_SIZE) {
+      printf("Image name %s is too long for %s\n", image.name.c_str(), file);
+      return false;
+    }
+
+    BundleEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    memcpy(entry.name, image.name.c_str(), image.name.size());
+    entry.x = image.x;
+    entry.y = image.y;
+    entry.width = image.width;
+    entry.height = image.height;
+    memcpy(&head[sizeof(header) + i * sizeof(entry)], &entry, sizeof(entry));
+  }
+
+  FILE * out = fopen(file, "wb");
+  if(out == NULL) {
+    printf("Failed to create %s\n", file);
+    return false;
+  }
+
+  bool written = fwrite(&head[0], head.size(), 1, out) == 1 &&
+                 fwrite(packed, (size_t)width * height * 4, 1, out) == 1;
+  if(fclose(out) != 0 || !written) {
+    printf("Failed to write %s\n", file);
+    return false;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Everything is checked against the file size before it is used, so a
+// truncated or stale bundle is turned down rather than read past its end
+bool TextureAtlas::map(const char * file) {
+  int fd = open(file, O_RDONLY);
+  if(fd < 0) return false;
+
+  struct stat info;
+  void * map = MAP_FAILED;
+  if(fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(BundleHeader)) {
+    map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if(map == MAP_FAILED) return false;
+
+  const uint8_t * bytes = (const uint8_t *)map;
+  size_t size = info.st_size;
+  const BundleHeader * header = (const BundleHeader *)bytes;
+
+  bool valid = memcmp(header->magic, BUNDLE_MAGIC, sizeof(header->magic)) == 0 &&
+               header->version == BUNDLE_VERSION && header->marker == BUNDLE_MARKER &&
+               header->image_count > 0 && header->image_count <= NOT_FOUND &&
+               sizeof(BundleHeader) + header->image_count * sizeof(BundleEntry) <= header->pixel_offset &&
+               header->pixel_offset % BUNDLE_ALIGN == 0 &&
+               header->pixel_offset + (uint64_t)header->width * header->height * 4 <= size;
+
+  std::vector<Image> bundle_images(valid ? header->image_count : 0);
+  const BundleEntry * entries = (const BundleEntry *)(bytes + sizeof(BundleHeader));
+
+  for(unsigned int i = 0; valid && i < bundle_images.size(); i++) {
+    const BundleEntry & entry = entries[i];
+    Image & image = bundle_images[i];
+    image.name.assign(entry.name, strnlen(entry.name, BUNDLE_NAME_SIZE - 1));
+    image.x = entry.x;
+    image.y = entry.y;
+    image.width = entry.width;
+    image.height = entry.height;
+
+    valid = image.x >= 0 && image.y >= 0 && image.width > 0 && image.height > 0 &&
+            image.x + image.width <= (int)header->width && image.y + image.height <= (int)header->height;
+  }
+
+  if(!valid) {
+    munmap(map, size);
+    return false;
+  }
+
+  unmap();
+  mapping = map;
+  mapping_size = size;
+
+  images.swap(bundle_images);
+  std::vector<uint8_t>().swap(pixels);
+  packed = bytes + header->pixel_offset;
+  width = header->width;
+  height = header->height;
+
+  regions.resize(images.size());
+  for(unsigned int i = 0; i < images.size(); i++) setRegion(i);
+
+  return true;
+}
@@ -0,0 +1,102 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Index of an image in the atlas
+typedef uint16_t AtlasId;
+
+// Where an image ended up, in atlas texture coordinates: (u0, v0) is the
+// image's texture coordinate (0, 0), its first pixel, and (u1, v1) is (1, 1)
+struct AtlasRegion {
+  float u0, v0, u1, v1;
+};
+
+// Packs all images the display uses into one texture at load time, so that
+// everything can be drawn without binding another texture. Each image gets a
+// one pixel border copied from its edges, so linear filtering at the edge of
+// an image never blends in its neighbour. The atlas itself has no GL in it,
+// so that the software renderer can use it too.
+//
+// A packed atlas can be saved to a bundle and mapped again by a later run,
+// which then needs no image decoding, composing or packing at all. Bundle
+// layout, in native byte order, which a marker word checks:
+//   header: "BBTA", uint32 version, uint32 marker 0x01020304,
+//           uint32 width, uint32 height, uint32 image count,
+//           uint32 offset of the pixels, a multiple of 4096
+//   index:  per image in ID order: char name[32], int32 x, y, width, height
+//   pixels: width * height RGBA, rows from the top
+class TextureAtlas {
+public:
+  // Always there: a small solid white image, for drawing plain colored boxes
+  static const AtlasId WHITE = 0;
+
+  // What find returns for a name no image has
+  static const AtlasId NOT_FOUND = 0xFFFF;
+
+  TextureAtlas();
+  ~TextureAtlas();
+
+  // Only the white image again
+  void clear();
+
+  // Copy in an RGBA image, rows from top to bottom, pitch bytes apart. Names
+  // are for finding the image again in a bundle, up to 31 characters.
+  AtlasId add(const uint8_t * rgba, int width, int height, int pitch, const std::string & name = "");
+
+  AtlasId find(const std::string & name) const;
+
+  // An image as added, RGBA rows from the top without padding. Only there
+  // until the atlas is packed.
+  const uint8_t * getImage(AtlasId id) const { return images[id].rgba.data(); }
+  int getImageWidth(AtlasId id) const { return images[id].width; }
+  int getImageHeight(AtlasId id) const { return images[id].height; }
+
+  // Lay out all added images in shelves, in an atlas no larger than
+  // max_size square. Returns false if they don't fit. Call after all images
+  // were added; packing again only checks the size.
+  bool pack(int max_size);
+
+  // Write the packed atlas to a bundle file. Prints why and returns false if
+  // it can't.
+  bool save(const char * file) const;
+
+  // Replace everything with the packed atlas in a bundle file, mapped
+  // read-only, so the pixels are never copied. Returns false, leaving the
+  // atlas as it was, if the file is missing or not a bundle of this version.
+  bool map(const char * file);
+
+  // Packed RGBA pixels, getWidth() per row, for a backend to upload or copy
+  int getWidth() const { return width; }
+  int getHeight() const { return height; }
+  const uint8_t * getPixels() const { return packed; }
+  const AtlasRegion & getRegion(AtlasId id) const { return regions[id]; }
+
+private:
+  struct Image {
+    std::string name;
+    int width, height;
+    int x, y;     // top left of the image itself, inside its border
+    std::vector<uint8_t> rgba;
+  };
+
+  TextureAtlas(const TextureAtlas &) = delete;
+  TextureAtlas & operator=(const TextureAtlas &) = delete;
+
+  void setRegion(AtlasId id);
+  void unmap();
+
+  std::vector<Image> images;
+  std::vector<AtlasRegion> regions;
+  std::vector<uint8_t> pixels;
+  const uint8_t * packed;     // pixels, or the pixels in the mapped bundle
+  int width, height;
+
+  void * mapping;
+  size_t mapping_size;
+};
+
+#endif
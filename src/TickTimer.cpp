@@ -0,0 +1,84 @@
+#include <errno.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include "LatencyStats.hpp"
+#include "TickTimer.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+static timespec toTimespec(uint64_t ns) {
+  timespec time;
+  time.tv_sec = ns / 1000000000ULL;
+  time.tv_nsec = ns % 1000000000ULL;
+  return time;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool NanosleepTimer::start(uint64_t period) {
+  period_ns = period;
+  deadline_ns = monotonicNs();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Deadlines that passed entirely while the caller was busy are skipped, so
+// it runs once, late, for the latest one rather than several times in a row
+unsigned long NanosleepTimer::wait() {
+  uint64_t next = deadline_ns + period_ns;
+  uint64_t now = monotonicNs();
+  unsigned long skipped = 0;
+
+  if(now >= next + period_ns) {
+    skipped = (now - next) / period_ns;
+    next += skipped * period_ns;
+  }
+
+  timespec until = toTimespec(next);
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR);
+
+  deadline_ns = next;
+  return skipped;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TimerfdTimer::TimerfdTimer() : fd(-1) {
+}
+
+////////////////////////////////////////////////////////////////////////////////
+TimerfdTimer::~TimerfdTimer() {
+  if(fd >= 0) close(fd);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool TimerfdTimer::start(uint64_t period) {
+  if(fd < 0) fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  if(fd < 0) {
+    printf("Failed to create timerfd: %d\n", errno);
+    return false;
+  }
+
+  period_ns = period;
+  deadline_ns = monotonicNs();
+
+  itimerspec spec;
+  spec.it_value = toTimespec(deadline_ns + period_ns);
+  spec.it_interval = toTimespec(period_ns);
+  if(timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, NULL) != 0) {
+    printf("Failed to start timerfd: %d\n", errno);
+    return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// The read blocks until the timer has expired at least once since the last
+// one, and returns how many times
+unsigned long TimerfdTimer::wait() {
+  uint64_t expirations = 0;
+  while(read(fd, &expirations, sizeof(expirations)) != sizeof(expirations) && errno == EINTR);
+
+  if(expirations == 0) expirations = 1;
+  deadline_ns += expirations * period_ns;
+  return expirations - 1;
+}
@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the TickTimer interface the controller thread waits on when
+/// built without Xenomai, and its two backends. Deadlines are absolute, a
+/// period apart on CLOCK_MONOTONIC, so how long a tick runs or how late it
+/// wakes up never shifts the ones after it. Missed deadlines are reported the
+/// way rt_task_wait_period reports overruns.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TICK_TIMER_H
+#define TICK_TIMER_H
+
+#include <cstdint>
+
+class TickTimer {
+public:
+  TickTimer() : period_ns(0), deadline_ns(0) {}
+  virtual ~TickTimer() {}
+
+  // Start the schedule, with the first deadline a period from now. Prints
+  // why and returns false if the timer can't be set up.
+  virtual bool start(uint64_t period) = 0;
+
+  // Sleep until the next deadline, or return at once if it has passed. If
+  // later deadlines passed as well, return for the latest of them and return
+  // how many were skipped; 0 otherwise.
+  virtual unsigned long wait() = 0;
+
+  // The deadline wait last returned for
+  uint64_t getDeadline() const { return deadline_ns; }
+
+protected:
+  uint64_t period_ns;
+  uint64_t deadline_ns;
+};
+
+// clock_nanosleep to each deadline with TIMER_ABSTIME. Works whatever the
+// kernel, and sleeps only when there is something to wait for.
+class NanosleepTimer : public TickTimer {
+public:
+  bool start(uint64_t period);
+  unsigned long wait();
+};
+
+// A periodic timerfd on CLOCK_MONOTONIC. The kernel keeps the schedule and
+// counts expirations, so wait is one read.
+class TimerfdTimer : public TickTimer {
+public:
+  TimerfdTimer();
+  ~TimerfdTimer();
+
+  bool start(uint64_t period);
+  unsigned long wait();
+
+private:
+  int fd;
+};
+
+#endif
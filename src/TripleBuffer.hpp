@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////////
+/// \file define the TripleBuffer class: hands complete frames from one writer
+/// thread to one reader thread without either of them ever waiting.
+///
+/// The writer fills back() and publishes it, the reader picks up the latest
+/// published frame with update() and reads it through front(). The third
+/// buffer sits between them and is swapped with an atomic exchange, so the
+/// writer never touches the frame being read and a frame published while the
+/// reader is busy simply replaces the one not yet picked up.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+template <typename T>
+class TripleBuffer {
+public:
+  TripleBuffer() : back_index(0), middle(1), front_index(2), version(0) {}
+
+  // Writer side: the frame to fill before the next publish()
+  T & back() { return buffers[back_index]; }
+
+  // Writer side: make back() the latest frame and start on an unused buffer
+  void publish() {
+    back_index = middle.exchange(back_index | FRESH, std::memory_order_acq_rel) & INDEX;
+  }
+
+  // Reader side: switch front() to the latest published frame.
+  // Returns false if nothing was published since the last call.
+  bool update() {
+    if(!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+
+    front_index = middle.exchange(front_index, std::memory_order_acq_rel) & INDEX;
+    version++;
+    return true;
+  }
+
+  // Reader side: the frame picked up by the last update()
+  const T & front() const { return buffers[front_index]; }
+
+  // Reader side: number of frames picked up so far
+  uint32_t getVersion() const { return version; }
+
+private:
+  static const uint8_t INDEX = 0x3;
+  static const uint8_t FRESH = 0x4;
+
+  T buffers[3];
+  uint8_t back_index;           // owned by the writer
+  std::atomic<uint8_t> middle;  // shared, index plus FRESH flag
+  uint8_t front_index;          // owned by the reader
+  uint32_t version;             // owned by the reader
+};
+
+#endif
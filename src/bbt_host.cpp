@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// \file run many games at once in a SessionHost, played by random bots in
+// real time, one or more to a game, and report how much CPU they took: how
+// many sessions one core could keep up with at this input rate
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "LatencyStats.hpp"
+#include "PieceGenerator.hpp"
+#include "SessionHost.hpp"
+
+// how often the bots look at their games
+#define BOT_STEP_NS 10000000ULL
+
+static void usage ( const char* name )
+{
+  printf ( "usage: %s [-n sessions] [-b bots] [-j threads] [-d seconds] [-r rate] [-p]\n" , name ) ;
+  printf ( "  -n sessions  games to run (default 256)\n" ) ;
+  printf ( "  -b bots      bots playing each game, sharing its input rate (default 1)\n" ) ;
+  printf ( "  -j threads   threads to run them on (default one per cpu)\n" ) ;
+  printf ( "  -d seconds   how long to play (default 10)\n" ) ;
+  printf ( "  -r rate      inputs per session per second (default 4)\n" ) ;
+  printf ( "  -p           pin thread n to cpu n\n" ) ;
+}
+
+int main ( int argc , char** argv )
+{
+  unsigned int n_sessions = 256 ;
+  unsigned int n_bots = 1 ;
+  unsigned int n_threads = sysconf ( _SC_NPROCESSORS_ONLN ) ;
+  double seconds = 10 ;
+  double rate = 4 ;
+  bool pin = false ;
+
+  int opt ;
+  while ( ( opt = getopt ( argc , argv , "n:b:j:d:r:p" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 'n' : n_sessions = atoi ( optarg ) ; break ;
+      case 'b' : n_bots = atoi ( optarg ) ; break ;
+      case 'j' : n_threads = atoi ( optarg ) ; break ;
+      case 'd' : seconds = atof ( optarg ) ; break ;
+      case 'r' : rate = atof ( optarg ) ; break ;
+      case 'p' : pin = true ; break ;
+      default :  usage ( argv [ 0 ] ) ; return 1 ;
+    }
+  }
+  if ( n_sessions < 1 || n_bots < 1 || n_threads < 1 || seconds <= 0 || rate < 0 )
+  {
+    usage ( argv [ 0 ] ) ;
+    return 1 ;
+  }
+
+  static const int inputs [] = { EV_START_LEFT , EV_STOP_LEFT , EV_START_RIGHT
+                               , EV_STOP_RIGHT , EV_ROT_LEFT , EV_ROT_RIGHT
+                               , EV_START_DOWN , EV_STOP_DOWN } ;
+  PieceGenerator bot ;
+  bot . seed ( 1 ) ;
+
+  // each bot is an input source, bot n plays game n / n_bots
+  SessionHost host ( n_threads ) ;
+  for ( unsigned int loop = 0 ; loop < n_sessions ; ++loop )
+  {
+    host . addSession ( 1000 + loop ) ;
+    host . push ( loop , EV_PAUSE , 0 ) ;
+  }
+  for ( unsigned int loop = 0 ; loop < n_sessions * n_bots ; ++loop )
+    host . bindSource ( loop , loop / n_bots ) ;
+  if ( !host . start ( pin ) )
+    return 1 ;
+
+  // chance per bot per step of an input, in 1/65536
+  uint32_t chance = rate / n_bots * BOT_STEP_NS / 1e9 * 65536 ;
+  uint64_t start_ns = monotonicNs () ;
+  uint64_t end_ns = start_ns + ( uint64_t ) ( seconds * 1e9 ) ;
+  uint64_t next_ns = start_ns ;
+  unsigned int games = 0 ;
+
+  while ( monotonicNs () < end_ns )
+  {
+    next_ns += BOT_STEP_NS ;
+    timespec until = { ( time_t ) ( next_ns / 1000000000ULL ) , ( long ) ( next_ns % 1000000000ULL ) } ;
+    clock_nanosleep ( CLOCK_MONOTONIC , TIMER_ABSTIME , &until , NULL ) ;
+
+    uint64_t now = monotonicNs () ;
+    for ( unsigned int loop = 0 ; loop < n_sessions ; ++loop )
+    {
+      // start over, a new game is paused
+      if ( host . getStatus ( loop ) . game_over )
+      {
+        host . push ( loop , EV_PAUSE , now ) ;
+        host . push ( loop , EV_PAUSE , now ) ;
+        ++games ;
+      }
+      else
+      {
+        for ( unsigned int source = loop * n_bots ; source < ( loop + 1 ) * n_bots ; ++source )
+        {
+          if ( bot . nextBelow ( 65536 ) < chance )
+            host . pushFrom ( source , inputs [ bot . nextBelow ( 8 ) ] , now ) ;
+        }
+      }
+    }
+  }
+
+  host . stop () ;
+  double wall = ( monotonicNs () - start_ns ) * 1e-9 ;
+  double cpu = host . getThreadCpuNs () * 1e-9 ;
+
+  uint64_t ticks = 0 , score = 0 ;
+  for ( unsigned int loop = 0 ; loop < n_sessions ; ++loop )
+  {
+    SessionStatus status = host . getStatus ( loop ) ;
+    ticks += status . tick ;
+    score += status . score ;
+  }
+
+  printf ( "%u sessions, %u bot%s each, on %u threads%s for %.1f s, %.1f inputs per session per second\n"
+         , n_sessions , n_bots , n_bots == 1 ? "" : "s" , n_threads , pin ? " (pinned)" : "" , wall , rate ) ;
+  printf ( "ran %llu game ticks, %.1f per session per second, %u games finished, total score %llu\n"
+         , ( unsigned long long ) ticks , ticks / wall / n_sessions , games
+         , ( unsigned long long ) score ) ;
+  printf ( "%.1f wakeups per thread per second\n" , host . getWakeups () / wall / n_threads ) ;
+  host . getTickLateness () . print ( stdout , "tick lateness" ) ;
+  host . getInputLatency () . print ( stdout , "input latency" ) ;
+  printf ( "cpu %.3f s, %.2f%% of one core: %.1f us per session per second\n"
+         , cpu , 100 * cpu / wall , cpu / wall / n_sessions * 1e6 ) ;
+  printf ( "sessions per core at this load: %.0f\n"
+         , cpu > 0 ? n_sessions * wall / cpu : 0.0 ) ;
+  return 0 ;
+}
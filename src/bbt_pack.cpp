@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// \file pack the display's PNG images and block sprites into one bundle the
+// display maps at startup instead of decoding them, see TextureAtlas
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "Assets.hpp"
+#include "TextureAtlas.hpp"
+
+// Every GL this runs on takes a texture this large, and so does SoftBackend
+static const int MAX_ATLAS_SIZE = 2048 ;
+
+static double nowMs ()
+{
+  timespec now ;
+  clock_gettime ( CLOCK_MONOTONIC , &now ) ;
+  return now . tv_sec * 1e3 + now . tv_nsec * 1e-6 ;
+}
+
+static void usage ( const char* name )
+{
+  printf ( "usage: %s [-o bundle] textures\n" , name ) ;
+  printf ( "  -o bundle  write to bundle (default %s)\n" , BBT_ASSET_BUNDLE ) ;
+}
+
+int main ( int argc , char** argv )
+{
+  std :: string bundle = BBT_ASSET_BUNDLE ;
+
+  int opt ;
+  while ( ( opt = getopt ( argc , argv , "o:" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 'o' : bundle = optarg ; break ;
+      default :  usage ( argv [ 0 ] ) ; return 1 ;
+    }
+  }
+
+  if ( optind + 1 != argc )
+  {
+    usage ( argv [ 0 ] ) ;
+    return 1 ;
+  }
+
+  // Same steps as the display without a bundle
+  double start = nowMs () ;
+  TextureAtlas atlas ;
+  Assets assets ;
+  if ( !loadAssetImages ( atlas , assets , argv [ optind ] ) )
+    return 1 ;
+
+  if ( !atlas . pack ( MAX_ATLAS_SIZE ) )
+  {
+    printf ( "textures don't fit in a %dx%d atlas\n" , MAX_ATLAS_SIZE , MAX_ATLAS_SIZE ) ;
+    return 1 ;
+  }
+  double decoded = nowMs () ;
+
+  if ( !atlas . save ( bundle . c_str () ) )
+    return 1 ;
+
+  // Check the bundle has everything the display looks for
+  double map_start = nowMs () ;
+  TextureAtlas mapped ;
+  if ( !mapped . map ( bundle . c_str () ) || !findAssets ( mapped , assets ) )
+  {
+    printf ( "%s does not read back\n" , bundle . c_str () ) ;
+    unlink ( bundle . c_str () ) ;
+    return 1 ;
+  }
+  double map_end = nowMs () ;
+
+  printf ( "%s: %dx%d atlas, decoded and packed in %.1f ms, maps in %.2f ms\n"
+         , bundle . c_str () , atlas . getWidth () , atlas . getHeight ()
+         , decoded - start , map_end - map_start ) ;
+  return 0 ;
+}
@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// \file replay a journal recorded with "bbt -r" through the game engine as
+// fast as possible, without RT, input or display
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "GameEngine.hpp"
+#include "Journal.hpp"
+
+static void usage ( const char* name )
+{
+  printf ( "usage: %s [-n repeat] journal\n" , name ) ;
+  printf ( "  -n repeat  replay the journal repeat times, for profiling\n" ) ;
+}
+
+int main ( int argc , char** argv )
+{
+  int repeat = 1 ;
+
+  int opt ;
+  while ( ( opt = getopt ( argc , argv , "n:" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 'n' : repeat = atoi ( optarg ) ; break ;
+      default :  usage ( argv [ 0 ] ) ; return 1 ;
+    }
+  }
+
+  if ( optind >= argc || repeat < 1 )
+  {
+    usage ( argv [ 0 ] ) ;
+    return 1 ;
+  }
+
+  JournalReader journal ;
+  if ( !journal . open ( argv [ optind ] ) )
+  {
+    printf ( "failed to open journal %s\n" , argv [ optind ] ) ;
+    return 1 ;
+  }
+  if ( journal . isLossy () )
+  {
+    printf ( "journal %s lost records while recording, replaying it would not give the recorded game\n"
+           , argv [ optind ] ) ;
+    return 1 ;
+  }
+
+  GameEngine engine ;
+  timespec start , end ;
+  clock_gettime ( CLOCK_MONOTONIC , &start ) ;
+
+  for ( int loop = 0 ; loop < repeat ; ++loop )
+  {
+    if ( !journal . replay ( engine ) )
+    {
+      printf ( "journal is truncated or unreadable\n" ) ;
+      return 1 ;
+    }
+  }
+
+  clock_gettime ( CLOCK_MONOTONIC , &end ) ;
+  double secs = ( end . tv_sec - start . tv_sec ) + ( end . tv_nsec - start . tv_nsec ) * 1e-9 ;
+  double game_minutes = ( double ) engine . getTick () * repeat / ( 60.0 * 60.0 ) ;
+
+  const GameState& state = engine . snapshot () ;
+  printf ( "seed %llu mode %s\n"
+         , ( unsigned long long ) journal . getSeed ()
+         , journal . getMode () == PieceGenerator :: MODE_BAG ? "bag" : "random" ) ;
+  printf ( "final tick %u score %u level %u lines %u%s\n"
+         , engine . getTick () , state . score , state . level , state . lines_cleared
+         , state . game_over ? " (game over)" : "" ) ;
+  printf ( "replayed %.1f game minutes in %.3f s (%.0f game minutes/s)\n"
+         , game_minutes , secs , secs > 0 ? game_minutes / secs : 0.0 ) ;
+  return 0 ;
+}
@@ -0,0 +1,219 @@
+///////////////////////////////////////////////////////////////////////////////
+// \file print the counters of a running bbt from its shared memory segment,
+// see StatCounters. Like vmstat, the first line is the average since bbt
+// started, then one line per interval.
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "StatCounters.hpp"
+
+// A header again every this many lines
+static const int HEADER_LINES = 20 ;
+
+// Everything read at one time, so rates are taken over the same interval
+struct Sample
+{
+  uint64_t now_ns ;
+  uint64_t start_ns ;
+  uint64_t ticks , tick_run_ns , missed_periods ;
+  uint64_t events_consumed , events_dropped , deltas_deferred , journal_lost ;
+  uint64_t pieces_locked , lines_cleared , line_clears [ 4 ] ;
+  uint64_t frames_drawn , frames_skipped , resyncs , blocks_redrawn , flush_ns ;
+  uint64_t score , level ;
+} ;
+
+static uint64_t load ( const StatCounter &counter )
+{
+  return counter . load ( std :: memory_order_relaxed ) ;
+}
+
+static void takeSample ( const StatCounters* counters , Sample &sample )
+{
+  timespec now ;
+  clock_gettime ( CLOCK_MONOTONIC , &now ) ;
+  sample . now_ns = ( uint64_t ) now . tv_sec * 1000000000ULL + now . tv_nsec ;
+  sample . start_ns = counters -> start_ns ;
+
+  sample . ticks = load ( counters -> ticks ) ;
+  sample . tick_run_ns = load ( counters -> tick_run_ns ) ;
+  sample . missed_periods = load ( counters -> missed_periods ) ;
+  sample . events_consumed = load ( counters -> events_consumed ) ;
+  sample . events_dropped = load ( counters -> events_dropped ) ;
+  sample . deltas_deferred = load ( counters -> deltas_deferred ) ;
+  sample . journal_lost = load ( counters -> journal_lost ) ;
+  sample . pieces_locked = load ( counters -> pieces_locked ) ;
+  sample . lines_cleared = load ( counters -> lines_cleared ) ;
+  for ( int loop = 0 ; loop < 4 ; ++loop )
+    sample . line_clears [ loop ] = load ( counters -> line_clears [ loop ] ) ;
+  sample . frames_drawn = load ( counters -> frames_drawn ) ;
+  sample . frames_skipped = load ( counters -> frames_skipped ) ;
+  sample . resyncs = load ( counters -> resyncs ) ;
+  sample . blocks_redrawn = load ( counters -> blocks_redrawn ) ;
+  sample . flush_ns = load ( counters -> flush_ns ) ;
+  sample . score = load ( counters -> score ) ;
+  sample . level = load ( counters -> level ) ;
+}
+
+// Every counter as "name value", for scripts
+static void printTotals ( const Sample &s )
+{
+  printf ( "uptime_ns %llu\n" , ( unsigned long long ) ( s . now_ns - s . start_ns ) ) ;
+  printf ( "ticks %llu\n" , ( unsigned long long ) s . ticks ) ;
+  printf ( "tick_run_ns %llu\n" , ( unsigned long long ) s . tick_run_ns ) ;
+  printf ( "missed_periods %llu\n" , ( unsigned long long ) s . missed_periods ) ;
+  printf ( "events_consumed %llu\n" , ( unsigned long long ) s . events_consumed ) ;
+  printf ( "events_dropped %llu\n" , ( unsigned long long ) s . events_dropped ) ;
+  printf ( "deltas_deferred %llu\n" , ( unsigned long long ) s . deltas_deferred ) ;
+  printf ( "journal_lost %llu\n" , ( unsigned long long ) s . journal_lost ) ;
+  printf ( "pieces_locked %llu\n" , ( unsigned long long ) s . pieces_locked ) ;
+  printf ( "lines_cleared %llu\n" , ( unsigned long long ) s . lines_cleared ) ;
+  for ( int loop = 0 ; loop < 4 ; ++loop )
+    printf ( "line_clears_%d %llu\n" , loop + 1 , ( unsigned long long ) s . line_clears [ loop ] ) ;
+  printf ( "frames_drawn %llu\n" , ( unsigned long long ) s . frames_drawn ) ;
+  printf ( "frames_skipped %llu\n" , ( unsigned long long ) s . frames_skipped ) ;
+  printf ( "resyncs %llu\n" , ( unsigned long long ) s . resyncs ) ;
+  printf ( "blocks_redrawn %llu\n" , ( unsigned long long ) s . blocks_redrawn ) ;
+  printf ( "flush_ns %llu\n" , ( unsigned long long ) s . flush_ns ) ;
+  printf ( "score %llu\n" , ( unsigned long long ) s . score ) ;
+  printf ( "level %llu\n" , ( unsigned long long ) s . level ) ;
+}
+
+static void printHeader ()
+{
+  printf ( "-------------- controller ------------- ------ game ------ ------------ display ------------\n" ) ;
+  printf ( "ticks/s  tick_us miss  ev/s drop defer jlost pieces lines  fps  skip sync blk/f flush_us  level  score\n" ) ;
+}
+
+static double perSecond ( uint64_t count , double secs )
+{
+  return secs > 0 ? count / secs : 0.0 ;
+}
+
+static double mean ( uint64_t total , uint64_t n )
+{
+  return n ? ( double ) total / n : 0.0 ;
+}
+
+// Rates from what changed between two samples
+static void printLine ( const Sample &a , const Sample &b )
+{
+  double secs = ( b . now_ns - a . now_ns ) * 1e-9 ;
+  uint64_t ticks = b . ticks - a . ticks ;
+  uint64_t frames = b . frames_drawn - a . frames_drawn ;
+
+  printf ( "%7.1f %8.1f %4llu %5.1f %4llu %5llu %5llu %6llu %5llu %4.1f %5llu %4llu %5.1f %8.1f %6llu %6llu\n"
+         , perSecond ( ticks , secs )
+         , mean ( b . tick_run_ns - a . tick_run_ns , ticks ) / 1e3
+         , ( unsigned long long ) ( b . missed_periods - a . missed_periods )
+         , perSecond ( b . events_consumed - a . events_consumed , secs )
+         , ( unsigned long long ) ( b . events_dropped - a . events_dropped )
+         , ( unsigned long long ) ( b . deltas_deferred - a . deltas_deferred )
+         , ( unsigned long long ) ( b . journal_lost - a . journal_lost )
+         , ( unsigned long long ) ( b . pieces_locked - a . pieces_locked )
+         , ( unsigned long long ) ( b . lines_cleared - a . lines_cleared )
+         , perSecond ( frames , secs )
+         , ( unsigned long long ) ( b . frames_skipped - a . frames_skipped )
+         , ( unsigned long long ) ( b . resyncs - a . resyncs )
+         , mean ( b . blocks_redrawn - a . blocks_redrawn , frames )
+         , mean ( b . flush_ns - a . flush_ns , frames ) / 1e3
+         , ( unsigned long long ) b . level
+         , ( unsigned long long ) b . score ) ;
+  fflush ( stdout ) ;
+}
+
+static void usage ( const char* name )
+{
+  printf ( "usage: %s [-t] [interval [count]]\n" , name ) ;
+  printf ( "  -t        print every counter once as \"name value\" and exit\n" ) ;
+  printf ( "  interval  seconds between lines (default 1)\n" ) ;
+  printf ( "  count     lines to print after the first (default until bbt exits)\n" ) ;
+}
+
+int main ( int argc , char** argv )
+{
+  bool totals = false ;
+
+  int opt ;
+  while ( ( opt = getopt ( argc , argv , "t" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 't' : totals = true ; break ;
+      default :  usage ( argv [ 0 ] ) ; return 1 ;
+    }
+  }
+
+  double interval = optind < argc ? atof ( argv [ optind ] ) : 1.0 ;
+  long count = optind + 1 < argc ? atol ( argv [ optind + 1 ] ) : -1 ;
+  if ( interval <= 0 || optind + 2 < argc )
+  {
+    usage ( argv [ 0 ] ) ;
+    return 1 ;
+  }
+
+  const StatCounters* counters = attachStatCounters () ;
+  if ( !counters )
+  {
+    printf ( "no counters at /dev/shm%s, is bbt running?\n" , BBT_STAT_NAME ) ;
+    return 1 ;
+  }
+
+  Sample last , now ;
+  takeSample ( counters , now ) ;
+  if ( totals )
+  {
+    printTotals ( now ) ;
+    return 0 ;
+  }
+
+  // Since bbt started
+  memset ( &last , 0 , sizeof ( last ) ) ;
+  last . now_ns = last . start_ns = now . start_ns ;
+  printHeader () ;
+  printLine ( last , now ) ;
+
+  timespec sleep_time ;
+  sleep_time . tv_sec = ( time_t ) interval ;
+  sleep_time . tv_nsec = ( long ) ( ( interval - sleep_time . tv_sec ) * 1e9 ) ;
+
+  for ( long lines = 1 ; count < 0 || lines <= count ; ++lines )
+  {
+    nanosleep ( &sleep_time , NULL ) ;
+
+    // each run makes a new segment, so follow a new bbt to its own
+    if ( kill ( counters -> pid , 0 ) != 0 && errno == ESRCH )
+    {
+      const StatCounters* next = attachStatCounters () ;
+      if ( !next || next -> pid == counters -> pid )
+      {
+        printf ( "bbt exited\n" ) ;
+        return 0 ;
+      }
+      munmap ( ( void* ) counters , sizeof ( StatCounters ) ) ;
+      counters = next ;
+    }
+    last = now ;
+    takeSample ( counters , now ) ;
+
+    // started from 0
+    if ( now . start_ns != last . start_ns )
+    {
+      printf ( "bbt restarted\n" ) ;
+      memset ( &last , 0 , sizeof ( last ) ) ;
+      last . now_ns = last . start_ns = now . start_ns ;
+    }
+
+    if ( lines % HEADER_LINES == 0 )
+      printHeader () ;
+    printLine ( last , now ) ;
+  }
+
+  return 0 ;
+}
@@ -4,6 +4,7 @@
 #include <string>
 #include <unistd.h>
 #include <libgen.h>
+#include <getopt.h>
 
 #ifndef NOXENOMAI
 #include <rtdk.h>
@@ -12,6 +13,15 @@
 #include "InputHandler.hpp"
 #include "GameController.hpp"
 #include "DisplayHandler.hpp"
+#include "FrameStats.hpp"
+#include "LatencyStats.hpp"
+#include "SoftBackend.hpp"
+#include "StatCounters.hpp"
+#include "TickTimer.hpp"
+
+#ifndef NOGL
+#include "SdlBackend.hpp"
+#endif
 
 //#include <posix.h>
 //#include <native/task.h>
@@ -23,7 +33,51 @@
 
 using namespace std ;
 
-int main () {
+static void usage(const char *name) {
+  printf("usage: %s [-b] [-f device] [-p] [-r journal] [-s stats] [-t timer]\n", name);
+  printf("  -b          deal pieces from shuffled bags of all 7\n");
+#ifdef NOGL
+  printf("  -f device   framebuffer to draw on (default /dev/fb0)\n");
+#else
+  printf("  -f device   draw on a framebuffer such as /dev/fb0, without X or GL\n");
+#endif
+  printf("  -p          show the frame time overlay (kill -USR2 toggles it)\n");
+  printf("  -r journal  record the game input to journal (see bbt_replay)\n");
+  printf("  -s stats    write frame time histograms to stats on exit\n");
+  printf("  -t timer    without xenomai, wait for ticks with nanosleep (default)\n");
+  printf("              or timerfd, or run tickless: only wake up for input and\n");
+  printf("              when the game changes\n");
+}
+
+int main(int argc, char **argv) {
+  latency_stats.start_ns = monotonicNs();
+
+  string journal_file;
+  string fb_device;
+  string timer_name = "nanosleep";
+  bool bag_mode = false;
+
+  int opt;
+  while((opt = getopt(argc, argv, "bf:pr:s:t:")) != -1) {
+    switch(opt) {
+      case 'b': bag_mode = true; break;
+      case 'f': fb_device = optarg; break;
+      case 'p': frame_stats.overlay = 1; break;
+      case 'r': journal_file = optarg; break;
+      case 's': frame_stats.save_file = optarg; break;
+      case 't': timer_name = optarg; break;
+      default:  usage(argv[0]); return 1;
+    }
+  }
+
+  // Relative to where we were started, not to the executable
+  char cwd[1024];
+  if(!journal_file.empty() && journal_file[0] != '/' && getcwd(cwd, sizeof(cwd))) {
+    journal_file = string(cwd) + "/" + journal_file;
+  }
+  if(!frame_stats.save_file.empty() && frame_stats.save_file[0] != '/' && getcwd(cwd, sizeof(cwd))) {
+    frame_stats.save_file = string(cwd) + "/" + frame_stats.save_file;
+  }
 
   // Attempt to change into the directory with the executable to ensure access to resources
   char exe_path[1024];
@@ -38,14 +92,66 @@ int main () {
   rt_print_auto_init ( 1 ) ;
 #endif
 
-  // Kick off input and controller threads
-  InputHandler input ;
-  input . start () ;
+  // kill -USR1 prints the input latency histograms, kill -USR2 toggles the
+  // frame time overlay, and SIGINT and SIGTERM save the frame stats
+  latency_stats.installSignal();
+  frame_stats.installSignals();
+
+  // Counters bbt_stat reads while the game runs
+  openStatCounters();
 
+  // The tick timers outlive the controller thread that waits on them
+#ifdef NOXENOMAI
+  NanosleepTimer nanosleep_timer;
+  TimerfdTimer timerfd_timer;
+#endif
+
+  // Set the controller and its journal up completely before any thread
+  // runs, so every event that reaches it is recorded
   GameController controller;
+
+  if(bag_mode) {
+    controller.setPieceMode(PieceGenerator::MODE_BAG);
+  }
+  if(!journal_file.empty() && !controller.startJournal(journal_file.c_str())) {
+    return 1;
+  }
+
+#ifdef NOXENOMAI
+  if(timer_name == "timerfd") {
+    controller.setTimer(&timerfd_timer);
+  } else if(timer_name == "nanosleep") {
+    controller.setTimer(&nanosleep_timer);
+  } else if(timer_name == "tickless") {
+    if(!controller.setTickless()) printf("no eventfd, ticking every period\n");
+  } else {
+    usage(argv[0]);
+    return 1;
+  }
+#endif
+
+  // Kick off controller and input threads
   controller.start();
 
+  InputHandler input ( &controller . getInputRing () ) ;
+  input . start () ;
+
   // Run display loop in main thread
-  DisplayHandler(controller);
-  return 0;
+#ifdef NOGL
+  SoftBackend backend(fb_device.empty() ? "/dev/fb0" : fb_device.c_str());
+  DisplayHandler(controller, backend);
+#else
+  if(!fb_device.empty()) {
+    SoftBackend backend(fb_device.c_str());
+    DisplayHandler(controller, backend);
+  } else {
+    SdlBackend backend;
+    DisplayHandler(controller, backend);
+  }
+#endif
+
+  // Stop ticking and terminate the journal. The input thread still runs, so
+  // exit without destroying what it uses.
+  controller.stop();
+  exit(0);
 }
@@ -0,0 +1,626 @@
+///////////////////////////////////////////////////////////////////////////////
+// \file microbenchmarks for the engine and render-prep hot paths.
+//
+// Every benchmark runs over a corpus of game states, either synthetic (the
+// engine driven by seeded random input) or sampled from a recorded journal.
+// Each sample times one pass over the corpus. The result is one JSON object
+// per benchmark, per line, with ns/op statistics over all samples.
+
+#include <algorithm>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#include "BBTdefines.hpp"
+#include "BlockTextureMap.hpp"
+#include "ShapeMap.hpp"
+#include "SoftBackend.hpp"
+#include "BoardView.hpp"
+#include "GameEngine.hpp"
+#include "GameState.hpp"
+#include "Journal.hpp"
+
+#define DEFAULT_SAMPLES 200
+#define DEFAULT_CORPUS_SIZE 256
+#define CORPUS_SAMPLE_TICKS 97
+
+// Moves tried by the collision benchmarks, as done by processTick and
+// processEvent
+static const int moves [] [ 3 ] = { { 0 , -1 , 0 } , { -1 , 0 , 0 } , { 1 , 0 , 0 }
+                                  , { 0 , 0 , 1 } , { 0 , 0 , -1 } } ;
+static const int n_moves = sizeof ( moves ) / sizeof ( moves [ 0 ] ) ;
+
+// Results are folded into this so the compiler cannot drop the work
+static volatile unsigned long sink ;
+
+static double nowNs ()
+{
+  timespec now ;
+  clock_gettime ( CLOCK_MONOTONIC , &now ) ;
+  return now . tv_sec * 1e9 + now . tv_nsec ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Timing and reporting
+///////////////////////////////////////////////////////////////////////////////
+struct BenchConfig
+{
+  int samples ;
+  const char* arch ;
+  const char* corpus ;
+  FILE* out ;
+} ;
+
+static double percentile ( const std::vector < double > &sorted , double p )
+{
+  double pos = p * ( sorted . size () - 1 ) ;
+  size_t low = ( size_t ) pos ;
+  size_t high = std :: min ( low + 1 , sorted . size () - 1 ) ;
+  return sorted [ low ] + ( sorted [ high ] - sorted [ low ] ) * ( pos - low ) ;
+}
+
+// Time body ( ) , which performs ops operations per call, and report ns/op
+template < typename Body >
+static void run ( const BenchConfig &config , const char* name , unsigned long ops , Body body )
+{
+  // warm up caches and branch predictors
+  for ( int loop = 0 ; loop < 3 ; ++loop )
+    body () ;
+
+  std :: vector < double > ns_per_op ;
+  for ( int loop = 0 ; loop < config . samples ; ++loop )
+  {
+    double start = nowNs () ;
+    body () ;
+    ns_per_op . push_back ( ( nowNs () - start ) / ops ) ;
+  }
+
+  std :: sort ( ns_per_op . begin () , ns_per_op . end () ) ;
+  double sum = 0 , sum_sq = 0 ;
+  for ( size_t loop = 0 ; loop < ns_per_op . size () ; ++loop )
+  {
+    sum += ns_per_op [ loop ] ;
+    sum_sq += ns_per_op [ loop ] * ns_per_op [ loop ] ;
+  }
+  double mean = sum / ns_per_op . size () ;
+  double stddev = sqrt ( std :: max ( 0.0 , sum_sq / ns_per_op . size () - mean * mean ) ) ;
+
+  fprintf ( config . out
+          , "{\"bench\":\"%s\",\"arch\":\"%s\",\"corpus\":\"%s\",\"ops_per_sample\":%lu"
+            ",\"samples\":%d,\"mean_ns\":%.3f,\"stddev_ns\":%.3f,\"min_ns\":%.3f"
+            ",\"p50_ns\":%.3f,\"p90_ns\":%.3f,\"p99_ns\":%.3f,\"max_ns\":%.3f}\n"
+          , name , config . arch , config . corpus , ops , config . samples
+          , mean , stddev , ns_per_op . front ()
+          , percentile ( ns_per_op , 0.50 ) , percentile ( ns_per_op , 0.90 )
+          , percentile ( ns_per_op , 0.99 ) , ns_per_op . back () ) ;
+  fflush ( config . out ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Corpora
+///////////////////////////////////////////////////////////////////////////////
+
+// Sample the engine state every CORPUS_SAMPLE_TICKS while it is running
+static void sampleState ( GameEngine &engine , std :: vector < GameState > &corpus )
+{
+  const GameState &state = engine . snapshot () ;
+  if ( !state . paused && !state . game_over
+    && engine . getTick () % CORPUS_SAMPLE_TICKS == 0 )
+  {
+    corpus . push_back ( state ) ;
+  }
+}
+
+// Run one tick of seeded random input, restarting after game over
+static void syntheticTick ( GameEngine &engine , PieceGenerator &script )
+{
+  static const int inputs [] = { EV_START_LEFT , EV_STOP_LEFT , EV_START_RIGHT
+                               , EV_STOP_RIGHT , EV_ROT_LEFT , EV_ROT_RIGHT
+                               , EV_START_DOWN , EV_STOP_DOWN } ;
+  static int start [ 2 ] = { EV_PAUSE , EV_PAUSE } ;
+
+  if ( engine . snapshot () . game_over )
+    engine . step ( start , 2 , 0 ) ;
+
+  if ( script . nextBelow ( 6 ) == 0 )
+  {
+    int event = inputs [ script . nextBelow ( 8 ) ] ;
+    engine . step ( &event , 1 , 1 ) ;
+  }
+  else
+  {
+    engine . step ( NULL , 0 , 1 ) ;
+  }
+}
+
+// Drive the engine with seeded random input
+static void syntheticCorpus ( size_t size , std :: vector < GameState > &corpus )
+{
+  GameEngine engine ( 1 ) ;
+  PieceGenerator script ;
+  script . seed ( 2 ) ;
+
+  int pause = EV_PAUSE ;
+  engine . step ( &pause , 1 , 0 ) ;
+
+  while ( corpus . size () < size )
+  {
+    syntheticTick ( engine , script ) ;
+    sampleState ( engine , corpus ) ;
+  }
+}
+
+// Replay a journal and sample it along the way
+static bool journalCorpus ( const char* filename , size_t size , std :: vector < GameState > &corpus )
+{
+  JournalReader journal ;
+  if ( !journal . open ( filename ) )
+    return false ;
+
+  GameEngine engine ;
+  engine . setPieceMode ( journal . getMode () ) ;
+  engine . reset ( journal . getSeed () ) ;
+
+  uint32_t tick = 0 ;
+  int event = EV_NONE ;
+  while ( corpus . size () < size && journal . next ( tick , event ) )
+  {
+    while ( engine . getTick () < tick )
+    {
+      engine . step ( NULL , 0 , 1 ) ;
+      sampleState ( engine , corpus ) ;
+    }
+    if ( event != EV_NONE )
+      engine . step ( &event , 1 , 0 ) ;
+  }
+  return !corpus . empty () ;
+}
+
+// Fill 1 to 4 random rows of each board, as seen right after a piece locks
+static void fullRowCorpus ( const std :: vector < GameState > &corpus , std :: vector < BoardState > &boards )
+{
+  PieceGenerator random ;
+  random . seed ( 3 ) ;
+
+  for ( size_t loop = 0 ; loop < corpus . size () ; ++loop )
+  {
+    BoardState board = corpus [ loop ] . board ;
+    int n_rows = 1 + random . nextBelow ( 4 ) ;
+    for ( int row = 0 ; row < n_rows ; ++row )
+    {
+      int y = random . nextBelow ( BOARD_HEIGHT ) ;
+      for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
+        board . set ( x , y , BlockData ( 1 , 1 + ( x + y ) % BlockData :: num_colors ) ) ;
+    }
+    boards . push_back ( board ) ;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+///////////////////////////////////////////////////////////////////////////////
+static void benchPieces ( const BenchConfig &config , const std :: vector < GameState > &corpus )
+{
+  const unsigned long ops = corpus . size () * n_moves ;
+
+  run ( config , "Tetromino::wouldIntersect" , ops , [&] () {
+    unsigned long hits = 0 ;
+    for ( size_t loop = 0 ; loop < corpus . size () ; ++loop )
+      for ( int move = 0 ; move < n_moves ; ++move )
+        hits += corpus [ loop ] . active . wouldIntersect ( corpus [ loop ] . board
+                                                         , moves [ move ] [ 0 ]
+                                                         , moves [ move ] [ 1 ]
+                                                         , moves [ move ] [ 2 ] ) ;
+    sink += hits ;
+  } ) ;
+
+  std :: vector < GameState > scratch = corpus ;
+  run ( config , "Tetromino::tryMove" , ops , [&] () {
+    unsigned long moved = 0 ;
+    for ( size_t loop = 0 ; loop < scratch . size () ; ++loop )
+    {
+      Tetromino piece = scratch [ loop ] . active ;
+      for ( int move = 0 ; move < n_moves ; ++move )
+        moved += piece . tryMove ( scratch [ loop ] . board
+                                 , moves [ move ] [ 0 ]
+                                 , moves [ move ] [ 1 ]
+                                 , moves [ move ] [ 2 ] ) ;
+    }
+    sink += moved ;
+  } ) ;
+
+  // placing the same piece again is idempotent, so the boards can be reused
+  run ( config , "Tetromino::place" , scratch . size () , [&] () {
+    for ( size_t loop = 0 ; loop < scratch . size () ; ++loop )
+      scratch [ loop ] . active . place ( scratch [ loop ] . board ) ;
+    sink += scratch . back () . board . getRow ( 0 ) ;
+  } ) ;
+}
+
+static void benchLines ( const BenchConfig &config , const std :: vector < GameState > &corpus )
+{
+  std :: vector < BoardState > boards ;
+  fullRowCorpus ( corpus , boards ) ;
+
+  run ( config , "GameEngine::getFullLines (all rows)" , boards . size () , [&] () {
+    int rows [ BOARD_HEIGHT ] ;
+    unsigned long found = 0 ;
+    for ( size_t loop = 0 ; loop < boards . size () ; ++loop )
+      found += boards [ loop ] . findFullRows ( rows ) ;
+    sink += found ;
+  } ) ;
+
+  // what the engine does after a lock: check only the rows the piece touched
+  std :: vector < RowSet > touched ;
+  for ( size_t loop = 0 ; loop < corpus . size () ; ++loop )
+  {
+    BoardState scratch = boards [ loop ] ;
+    touched . push_back ( corpus [ loop ] . active . place ( scratch ) ) ;
+  }
+  run ( config , "GameEngine::getFullLines (touched rows)" , boards . size () , [&] () {
+    int rows [ BOARD_HEIGHT ] ;
+    unsigned long found = 0 ;
+    for ( size_t loop = 0 ; loop < boards . size () ; ++loop )
+      found += boards [ loop ] . findFullRows ( rows , touched [ loop ] ) ;
+    sink += found ;
+  } ) ;
+
+  // removal is destructive, so time the copy on its own for reference
+  BoardState scratch ;
+  run ( config , "BoardState::copy" , boards . size () , [&] () {
+    for ( size_t loop = 0 ; loop < boards . size () ; ++loop )
+    {
+      scratch = boards [ loop ] ;
+      sink += scratch . getRow ( 0 ) ;
+    }
+  } ) ;
+
+  run ( config , "GameEngine::removeFullLines+copy" , boards . size () , [&] () {
+    int rows [ BOARD_HEIGHT ] ;
+    for ( size_t loop = 0 ; loop < boards . size () ; ++loop )
+    {
+      scratch = boards [ loop ] ;
+      int n_rows = scratch . findFullRows ( rows ) ;
+      scratch . removeRows ( rows , n_rows ) ;
+      sink += scratch . getRow ( 0 ) ;
+    }
+  } ) ;
+}
+
+static void benchState ( const BenchConfig &config , const std :: vector < GameState > &corpus )
+{
+  GameState out ;
+  run ( config , "GameController::getGameState copy" , corpus . size () , [&] () {
+    for ( size_t loop = 0 ; loop < corpus . size () ; ++loop )
+    {
+      out = corpus [ loop ] ;
+      sink += out . score ;
+    }
+  } ) ;
+}
+
+static void benchTextureMaps ( const BenchConfig &config , const std :: vector < GameState > &corpus )
+{
+  // distinct texture ids so the maps differ as they do on the display
+  block_textures . bg = 1 ; block_textures . outer = 2 ; block_textures . inner = 3 ;
+  block_textures . top = 4 ; block_textures . bottom = 5 ;
+  block_textures . left = 6 ; block_textures . right = 7 ;
+  BlockTextureMap :: buildShapeTable () ;
+
+  // boards as drawn, with the active piece stamped in
+  std :: vector < BoardState > boards ;
+  for ( size_t loop = 0 ; loop < corpus . size () ; ++loop )
+  {
+    GameState state = corpus [ loop ] ;
+    state . active . place ( state . board ) ;
+    boards . push_back ( state . board ) ;
+  }
+
+  std :: vector < BoardTextureMap > maps ( boards . size () ) ;
+  run ( config , "BlockTextureMap build (board)" , boards . size () , [&] () {
+    for ( size_t loop = 0 ; loop < boards . size () ; ++loop )
+      for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
+        for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+          maps [ loop ] [ x ] [ y ] = BlockTextureMap ( x , y , boards [ loop ] ) ;
+    sink += maps . back () [ 0 ] [ 0 ] . color ;
+  } ) ;
+
+  // each board against the one sampled before it, like last_board
+  run ( config , "BlockTextureMap compare (board)" , maps . size () , [&] () {
+    unsigned long changed = 0 ;
+    for ( size_t loop = 1 ; loop < maps . size () ; ++loop )
+      for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
+        for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+          changed += maps [ loop ] [ x ] [ y ] != maps [ loop - 1 ] [ x ] [ y ] ;
+    sink += changed ;
+  } ) ;
+
+  // the same two steps on packed shapes: build every row and diff it with
+  // the board sampled before
+  ShapeMap shapes ;
+  run ( config , "ShapeMap update and diff (board)" , boards . size () , [&] () {
+    unsigned long changed = 0 ;
+    for ( size_t loop = 0 ; loop < boards . size () ; ++loop )
+    {
+      shapes . updateAll ( boards [ loop ] ) ;
+      for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+        changed += shapes . getChanged ( y ) != 0 ;
+      shapes . clearChanged () ;
+    }
+    sink += changed ;
+  } ) ;
+}
+
+// Block images for the software renderer, with the ids benchTextureMaps gave
+// them, which are the first ones after TextureAtlas :: WHITE, and the block
+// sprites composed from them
+static void loadBlockImages ( SoftBackend &backend , TextureAtlas &atlas )
+{
+  std :: vector < uint8_t > pixels ( 20 * 20 * 4 ) ;
+  for ( AtlasId id = 1 ; id <= 7 ; ++id )
+  {
+    for ( size_t loop = 0 ; loop < pixels . size () ; ++loop )
+      pixels [ loop ] = loop % 4 == 3 ? 255 : ( loop * id ) & 0xFF ;
+    atlas . add ( &pixels [ 0 ] , 20 , 20 , 20 * 4 ) ;
+  }
+
+  BlockTextureMap :: buildSprites ( atlas ) ;
+  backend . open () ;
+  backend . load ( atlas ) ;
+}
+
+// Drawing whole boards on the CPU, as after a resync or unpause
+static void benchSoftRender ( const BenchConfig &config , const std :: vector < GameState > &corpus )
+{
+  TextureAtlas atlas ;
+  SoftBackend backend ;
+  loadBlockImages ( backend , atlas ) ;
+
+  std :: vector < BoardState > boards ;
+  for ( size_t loop = 0 ; loop < corpus . size () ; ++loop )
+  {
+    GameState state = corpus [ loop ] ;
+    state . active . place ( state . board ) ;
+    boards . push_back ( state . board ) ;
+  }
+
+  const float inset = ( AREA_WIDTH - BOARD_WIDTH ) / 2.0f ;
+  ShapeMap shapes ;
+  run ( config , "software render (board)" , boards . size () , [&] () {
+    for ( size_t loop = 0 ; loop < boards . size () ; ++loop )
+    {
+      shapes . updateAll ( boards [ loop ] ) ;
+      for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+        for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
+          backend . addBlock ( inset + x , y , 1.0f , BlockTextureMap ( shapes . get ( x , y ) ) ) ;
+      shapes . clearChanged () ;
+      backend . flush () ;
+    }
+    sink += backend . getPixels () [ BBT_SCREEN_WIDTH * 240 + 136 ] ;
+  } ) ;
+}
+
+// Per-tick render prep: the display updating only the cells named by the
+// GameDelta records, against rebuilding and diffing the whole board
+static void benchDeltas ( const BenchConfig &base_config , size_t n_ticks )
+{
+  // consecutive ticks are needed, so this always plays a synthetic game
+  BenchConfig config = base_config ;
+  config . corpus = "synthetic" ;
+
+  GameEngine engine ( 1 ) ;
+  PieceGenerator script ;
+  script . seed ( 2 ) ;
+
+  int pause = EV_PAUSE ;
+  engine . step ( &pause , 1 , 0 ) ;
+
+  // changes up to here are all in first
+  GameState first = engine . snapshot () ;
+  GameDelta delta ;
+  engine . takeDelta ( delta ) ;
+
+  std :: vector < GameDelta > deltas ( n_ticks ) ;
+  std :: vector < GameState > resyncs ;
+  std :: vector < BoardState > boards ;
+  for ( size_t loop = 0 ; loop < n_ticks ; ++loop )
+  {
+    syntheticTick ( engine , script ) ;
+    engine . takeDelta ( deltas [ loop ] ) ;
+    if ( deltas [ loop ] . resync )
+      resyncs . push_back ( engine . snapshot () ) ;
+
+    GameState state = engine . snapshot () ;
+    state . active . place ( state . board ) ;
+    boards . push_back ( state . board ) ;
+  }
+
+  BoardTextureMap last_board ;
+  run ( config , "render prep per tick (GameDelta)" , n_ticks , [&] () {
+    BoardView view ;
+    view . reset ( first ) ;
+    size_t next_resync = 0 ;
+    unsigned long drawn = 0 ;
+    for ( size_t loop = 0 ; loop < deltas . size () ; ++loop )
+    {
+      if ( !view . apply ( deltas [ loop ] ) )
+        view . reset ( resyncs [ next_resync++ ] ) ;
+
+      for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+      {
+        RowMask redraw = view . getRedraw ( y ) ;
+        for ( int x = 0 ; redraw ; ++x , redraw >>= 1 )
+        {
+          if ( !( redraw & 1 ) )
+            continue ;
+          BlockTextureMap block_tex ( x , y , view . getShown () ) ;
+          if ( block_tex != last_board [ x ] [ y ] )
+          {
+            last_board [ x ] [ y ] = block_tex ;
+            ++drawn ;
+          }
+        }
+      }
+      view . clearRedraw () ;
+    }
+    sink += drawn ;
+  } ) ;
+
+  ShapeMap shapes ;
+  run ( config , "render prep per tick (GameDelta, ShapeMap)" , n_ticks , [&] () {
+    BoardView view ;
+    view . reset ( first ) ;
+    size_t next_resync = 0 ;
+    unsigned long drawn = 0 ;
+    for ( size_t loop = 0 ; loop < deltas . size () ; ++loop )
+    {
+      if ( !view . apply ( deltas [ loop ] ) )
+        view . reset ( resyncs [ next_resync++ ] ) ;
+
+      shapes . update ( view . getShown () , view . getRedrawRows () ) ;
+      for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+      {
+        RowMask changed = shapes . getChanged ( y ) ;
+        for ( int x = 0 ; changed ; ++x , changed >>= 1 )
+        {
+          if ( !( changed & 1 ) )
+            continue ;
+          BlockTextureMap block_tex ( shapes . get ( x , y ) ) ;
+          sink += block_tex . color ;
+          ++drawn ;
+        }
+      }
+      shapes . clearChanged () ;
+      view . clearRedraw () ;
+    }
+    sink += drawn ;
+  } ) ;
+
+  // the same, drawing the changed cells on the CPU and flushing them
+  TextureAtlas atlas ;
+  SoftBackend backend ;
+  loadBlockImages ( backend , atlas ) ;
+  const float inset = ( AREA_WIDTH - BOARD_WIDTH ) / 2.0f ;
+
+  run ( config , "software render per tick (GameDelta, ShapeMap)" , n_ticks , [&] () {
+    BoardView view ;
+    view . reset ( first ) ;
+    size_t next_resync = 0 ;
+    for ( size_t loop = 0 ; loop < deltas . size () ; ++loop )
+    {
+      if ( !view . apply ( deltas [ loop ] ) )
+        view . reset ( resyncs [ next_resync++ ] ) ;
+
+      shapes . update ( view . getShown () , view . getRedrawRows () ) ;
+      for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+      {
+        RowMask changed = shapes . getChanged ( y ) ;
+        for ( int x = 0 ; changed ; ++x , changed >>= 1 )
+          if ( changed & 1 )
+            backend . addBlock ( inset + x , y , 1.0f , BlockTextureMap ( shapes . get ( x , y ) ) ) ;
+      }
+      shapes . clearChanged () ;
+      view . clearRedraw () ;
+      backend . flush () ;
+    }
+    sink += backend . getFlushedPixels () ;
+  } ) ;
+
+  run ( config , "render prep per tick (full diff)" , n_ticks , [&] () {
+    unsigned long drawn = 0 ;
+    for ( size_t loop = 0 ; loop < boards . size () ; ++loop )
+    {
+      for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
+        for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+        {
+          BlockTextureMap block_tex ( x , y , boards [ loop ] ) ;
+          if ( block_tex != last_board [ x ] [ y ] )
+          {
+            last_board [ x ] [ y ] = block_tex ;
+            ++drawn ;
+          }
+        }
+    }
+    sink += drawn ;
+  } ) ;
+}
+
+static void usage ( const char* name )
+{
+  printf ( "usage: %s [-s samples] [-c corpus size] [-j journal] [-o output]\n" , name ) ;
+  printf ( "  -s samples      timed passes per benchmark (default %d)\n" , DEFAULT_SAMPLES ) ;
+  printf ( "  -c corpus size  game states per pass (default %d)\n" , DEFAULT_CORPUS_SIZE ) ;
+  printf ( "  -j journal      sample states from a recorded journal instead of\n"
+           "                  synthetic games\n" ) ;
+  printf ( "  -o output       write the JSON lines to output instead of stdout\n" ) ;
+}
+
+int main ( int argc , char** argv )
+{
+  BenchConfig config ;
+  config . samples = DEFAULT_SAMPLES ;
+  config . corpus = "synthetic" ;
+  config . out = stdout ;
+  size_t corpus_size = DEFAULT_CORPUS_SIZE ;
+  const char* journal = NULL ;
+
+  int opt ;
+  while ( ( opt = getopt ( argc , argv , "s:c:j:o:" ) ) != -1 )
+  {
+    switch ( opt )
+    {
+      case 's' : config . samples = atoi ( optarg ) ; break ;
+      case 'c' : corpus_size = atoi ( optarg ) ; break ;
+      case 'j' : journal = optarg ; break ;
+      case 'o' :
+        config . out = fopen ( optarg , "w" ) ;
+        if ( config . out == NULL )
+        {
+          printf ( "failed to open %s\n" , optarg ) ;
+          return 1 ;
+        }
+        break ;
+      default : usage ( argv [ 0 ] ) ; return 1 ;
+    }
+  }
+
+  if ( config . samples < 1 || corpus_size < 2 )
+  {
+    usage ( argv [ 0 ] ) ;
+    return 1 ;
+  }
+
+  utsname machine ;
+  config . arch = uname ( &machine ) == 0 ? machine . machine : "unknown" ;
+
+  std :: vector < GameState > corpus ;
+  if ( journal )
+  {
+    config . corpus = journal ;
+    if ( !journalCorpus ( journal , corpus_size , corpus ) )
+    {
+      printf ( "failed to read states from journal %s\n" , journal ) ;
+      return 1 ;
+    }
+  }
+  else
+  {
+    syntheticCorpus ( corpus_size , corpus ) ;
+  }
+
+  benchPieces ( config , corpus ) ;
+  benchLines ( config , corpus ) ;
+  benchState ( config , corpus ) ;
+  benchTextureMaps ( config , corpus ) ;
+  benchSoftRender ( config , corpus ) ;
+  benchDeltas ( config , corpus_size * 8 ) ;
+
+  if ( config . out != stdout )
+    fclose ( config . out ) ;
+  return 0 ;
+}
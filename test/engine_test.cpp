@@ -0,0 +1,878 @@
+///////////////////////////////////////////////////////////////////////////////
+// \file test the GameEngine and board logic without any RT, input or display
+// dependencies. Returns non-zero if any check fails.
+
+#include "GameEngine.hpp"
+#include "BoardState.hpp"
+#include "Tetromino.hpp"
+#include "BBTdefines.hpp"
+#include "Journal.hpp"
+#include "BoardView.hpp"
+#include "EventRing.hpp"
+#include "Histogram.hpp"
+#include "LatencyStats.hpp"
+#include "SessionHost.hpp"
+#include "ShapeMap.hpp"
+#include "TickTimer.hpp"
+#include "TripleBuffer.hpp"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+static int failures = 0 ;
+
+#define CHECK(cond) \
+  do { \
+    if ( !( cond ) ) \
+    { \
+      printf ( "%s:%d: check failed: %s\n" , __FILE__ , __LINE__ , #cond ) ; \
+      ++failures ; \
+    } \
+  } while ( 0 )
+
+///////////////////////////////////////////////////////////////////////////////
+// row masks follow writes to the board
+static void testBoardMasks ()
+{
+  BoardState board ;
+  CHECK ( board . getRow ( 0 ) == 0 ) ;
+
+  for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
+    board . set ( x , 0 , BlockData ( 1 , 1 ) ) ;
+  CHECK ( board . isRowFull ( 0 ) ) ;
+
+  board . set ( 3 , 0 , BlockData ( 0 , 0 ) ) ;
+  CHECK ( !board . isRowFull ( 0 ) ) ;
+  CHECK ( board . getRow ( 0 ) == ( FULL_ROW_MASK & ~( 1 << 3 ) ) ) ;
+
+  board . copyRow ( 1 , 0 ) ;
+  CHECK ( board . getRow ( 1 ) == board . getRow ( 0 ) ) ;
+  CHECK ( board . get ( 4 , 1 ) == BlockData ( 1 , 1 ) ) ;
+
+  board . clearRow ( 0 ) ;
+  CHECK ( board . getRow ( 0 ) == 0 ) ;
+  CHECK ( board . get ( 4 , 0 ) == BlockData ( 0 , 0 ) ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// full rows are only reported among the candidates, and removing them drops
+// every row above by the number of removed rows below it
+static void testRemoveRows ()
+{
+  BoardState board ;
+  for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+    board . set ( 0 , y , BlockData ( y + 1 , 1 ) ) ;
+  for ( int x = 1 ; x < BOARD_WIDTH ; ++x )
+  {
+    board . set ( x , 2 , BlockData ( 1 , 1 ) ) ;
+    board . set ( x , 3 , BlockData ( 1 , 1 ) ) ;
+    board . set ( x , 7 , BlockData ( 1 , 1 ) ) ;
+  }
+
+  int rows [ BOARD_HEIGHT ] ;
+  CHECK ( board . findFullRows ( rows , 1u << 7 | 1u << 8 ) == 1 && rows [ 0 ] == 7 ) ;
+  CHECK ( board . findFullRows ( rows ) == 3 ) ;
+  CHECK ( rows [ 0 ] == 2 && rows [ 1 ] == 3 && rows [ 2 ] == 7 ) ;
+
+  board . removeRows ( rows , 3 ) ;
+  static const int expected [] = { 1 , 2 , 5 , 6 , 7 , 9 } ;
+  for ( int y = 0 ; y < 6 ; ++y )
+    CHECK ( board . get ( 0 , y ) . id == expected [ y ] ) ;
+  CHECK ( board . get ( 0 , BOARD_HEIGHT - 4 ) . id == BOARD_HEIGHT ) ;
+  for ( int y = BOARD_HEIGHT - 3 ; y < BOARD_HEIGHT ; ++y )
+    CHECK ( board . getRow ( y ) == 0 ) ;
+  CHECK ( board . findFullRows ( rows ) == 0 ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// generated shapes have four cells, match the hand written table they
+// replaced in every rotation, and getValue keeps its bounds checks
+static void testPieceShapes ()
+{
+  // values [ color - 1 ][ top row first ][ rotation ][ x ], as shipped.
+  // Journals recorded with it must replay the same
+  static const int hand_table [ BlockData :: num_colors ][ Tetromino :: height ][ Tetromino :: num_rotations ][ Tetromino :: width ] = {
+  {
+    {{0,0,0,0}, {0,0,1,0}, {0,0,0,0}, {0,0,1,0}},
+    {{1,1,1,1}, {0,0,1,0}, {1,1,1,1}, {0,0,1,0}},
+    {{0,0,0,0}, {0,0,1,0}, {0,0,0,0}, {0,0,1,0}},
+    {{0,0,0,0}, {0,0,1,0}, {0,0,0,0}, {0,0,1,0}},
+  }, {
+    {{0,0,0,0}, {0,0,0,0}, {0,0,0,0}, {0,0,0,0}},
+    {{1,1,1,0}, {0,1,0,0}, {0,1,0,0}, {0,1,0,0}},
+    {{0,1,0,0}, {0,1,1,0}, {1,1,1,0}, {1,1,0,0}},
+    {{0,0,0,0}, {0,1,0,0}, {0,0,0,0}, {0,1,0,0}},
+  }, {
+    {{0,0,0,0}, {0,0,0,0}, {0,0,0,0}, {0,0,0,0}},
+    {{1,1,0,0}, {1,1,0,0}, {1,1,0,0}, {1,1,0,0}},
+    {{1,1,0,0}, {1,1,0,0}, {1,1,0,0}, {1,1,0,0}},
+    {{0,0,0,0}, {0,0,0,0}, {0,0,0,0}, {0,0,0,0}},
+  }, {
+    {{0,0,0,0}, {0,0,0,0}, {0,0,0,0}, {0,0,0,0}},
+    {{1,1,1,0}, {1,1,0,0}, {0,0,1,0}, {1,0,0,0}},
+    {{1,0,0,0}, {0,1,0,0}, {1,1,1,0}, {1,0,0,0}},
+    {{0,0,0,0}, {0,1,0,0}, {0,0,0,0}, {1,1,0,0}},
+  }, {
+    {{0,0,0,0}, {0,0,0,0}, {0,0,0,0}, {0,0,0,0}},
+    {{1,0,0,0}, {1,1,0,0}, {1,1,1,0}, {0,1,0,0}},
+    {{1,1,1,0}, {1,0,0,0}, {0,0,1,0}, {0,1,0,0}},
+    {{0,0,0,0}, {1,0,0,0}, {0,0,0,0}, {1,1,0,0}},
+  }, {
+    {{0,0,0,0}, {0,0,0,0}, {0,0,0,0}, {0,0,0,0}},
+    {{1,1,0,0}, {0,1,0,0}, {1,1,0,0}, {0,1,0,0}},
+    {{0,1,1,0}, {1,1,0,0}, {0,1,1,0}, {1,1,0,0}},
+    {{0,0,0,0}, {1,0,0,0}, {0,0,0,0}, {1,0,0,0}},
+  }, {
+    {{0,0,0,0}, {0,0,0,0}, {0,0,0,0}, {0,0,0,0}},
+    {{0,1,1,0}, {1,0,0,0}, {0,1,1,0}, {1,0,0,0}},
+    {{1,1,0,0}, {1,1,0,0}, {1,1,0,0}, {1,1,0,0}},
+    {{0,0,0,0}, {0,1,0,0}, {0,0,0,0}, {0,1,0,0}},
+  }
+  } ;
+
+  for ( int color = 1 ; color <= BlockData :: num_colors ; ++color )
+  {
+    for ( int rot = 0 ; rot < Tetromino :: num_rotations ; ++rot )
+    {
+      int cells = 0 , wrong = 0 ;
+      for ( int x = 0 ; x < Tetromino :: width ; ++x )
+        for ( int y = 0 ; y < Tetromino :: height ; ++y )
+        {
+          bool value = Tetromino :: getValue ( color , rot , x , y ) ;
+          cells += value ;
+          wrong += value != ( hand_table [ color - 1 ][ Tetromino :: height - 1 - y ][ rot ][ x ] != 0 ) ;
+        }
+      CHECK ( cells == Tetromino :: num_cells ) ;
+      CHECK ( wrong == 0 ) ;
+    }
+  }
+
+  bool thrown = false ;
+  try
+  {
+    Tetromino :: getValue ( 1 , 0 , Tetromino :: width , 0 ) ;
+  }
+  catch ( ... )
+  {
+    thrown = true ;
+  }
+  CHECK ( thrown ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// the game starts paused and only runs after EV_PAUSE
+static void testPauseAndDrop ()
+{
+  GameEngine engine ;
+  CHECK ( engine . snapshot () . paused ) ;
+
+  int start_y = engine . snapshot () . active . pos_y ;
+  engine . step ( NULL , 0 , 500 ) ;
+  CHECK ( engine . snapshot () . active . pos_y == start_y ) ;
+
+  int event = EV_PAUSE ;
+  engine . step ( &event , 1 , 200 ) ;
+  CHECK ( !engine . snapshot () . paused ) ;
+  CHECK ( engine . snapshot () . active . pos_y < start_y ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// holding down stacks pieces until the game is over, then pause restarts it
+static void testGameOver ()
+{
+  GameEngine engine ;
+  int events [ 2 ] = { EV_PAUSE , EV_START_DOWN } ;
+  engine . step ( events , 2 , 0 ) ;
+
+  for ( int loop = 0 ; loop < 100000 && !engine . snapshot () . game_over ; ++loop )
+    engine . step ( NULL , 0 , 1 ) ;
+
+  CHECK ( engine . snapshot () . game_over ) ;
+  CHECK ( engine . snapshot () . score > 0 ) ;
+
+  // one point per piece, and no line is ever full
+  uint32_t pieces = engine . getPiecesLocked () ;
+  CHECK ( pieces == engine . snapshot () . score ) ;
+
+  events [ 0 ] = EV_PAUSE ;
+  engine . step ( events , 1 , 0 ) ;
+  CHECK ( !engine . snapshot () . game_over ) ;
+  CHECK ( engine . snapshot () . score == 0 ) ;
+  CHECK ( engine . getPiecesLocked () == pieces ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// the same seed and events give the same game, bag mode deals every piece
+// once per 7
+static void testSeeding ()
+{
+  GameEngine a ( 1234 ) , b ( 1234 ) , c ( 4321 ) ;
+  int events [ 2 ] = { EV_PAUSE , EV_START_DOWN } ;
+  a . step ( events , 2 , 5000 ) ;
+  b . step ( events , 2 , 5000 ) ;
+  c . step ( events , 2 , 5000 ) ;
+
+  GameState sa = a . snapshot () , sb = b . snapshot () , sc = c . snapshot () ;
+  CHECK ( sa . score == sb . score ) ;
+  CHECK ( sa . next == sb . next ) ;
+  CHECK ( sa . generator . next () == sb . generator . next () ) ;
+  CHECK ( sa . generator . next () != sc . generator . next () ) ;
+
+  PieceGenerator generator ;
+  generator . seed ( 99 ) ;
+  generator . setMode ( PieceGenerator :: MODE_BAG ) ;
+  for ( int bag = 0 ; bag < 10 ; ++bag )
+  {
+    int seen = 0 ;
+    for ( int loop = 0 ; loop < BlockData :: num_colors ; ++loop )
+      seen |= 1 << generator . nextPiece () . color ;
+    CHECK ( seen == 0xFE ) ;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// a session recorded the way GameController records it replays to the same
+// state
+static void testJournalReplay ()
+{
+  char filename [] = "/tmp/bbt_journal_XXXXXX" ;
+  int fd = mkstemp ( filename ) ;
+  CHECK ( fd >= 0 ) ;
+  close ( fd ) ;
+
+  GameEngine live ;
+  live . setPieceMode ( PieceGenerator :: MODE_BAG ) ;
+  live . reset ( 777 ) ;
+
+  // far faster than real time, so written from this thread
+  JournalWriter writer ( false ) ;
+  CHECK ( writer . open ( filename , 777 , PieceGenerator :: MODE_BAG ) ) ;
+
+  const int inputs [] = { EV_PAUSE , EV_START_LEFT , EV_ROT_RIGHT , EV_STOP_LEFT
+                        , EV_START_DOWN , EV_START_RIGHT , EV_STOP_DOWN
+                        , EV_ROT_LEFT , EV_STOP_RIGHT } ;
+  const int n_inputs = sizeof ( inputs ) / sizeof ( inputs [ 0 ] ) ;
+  PieceGenerator script ;
+  script . seed ( 5 ) ;
+
+  for ( int loop = 0 ; loop < 200000 ; ++loop )
+  {
+    int events [ 2 ] ;
+    unsigned int n_events = 0 ;
+    if ( loop == 0 )
+      events [ n_events++ ] = EV_PAUSE ;
+    else if ( script . nextBelow ( 8 ) == 0 )
+      events [ n_events++ ] = inputs [ 1 + script . nextBelow ( n_inputs - 1 ) ] ;
+    if ( live . snapshot () . game_over )
+      events [ n_events++ ] = EV_PAUSE ;
+
+    for ( unsigned int event = 0 ; event < n_events ; ++event )
+      writer . record ( live . getTick () , events [ event ] ) ;
+    live . step ( events , n_events , 1 ) ;
+  }
+  CHECK ( writer . close ( live . getTick () ) ) ;
+
+  JournalReader reader ;
+  CHECK ( reader . open ( filename ) ) ;
+  CHECK ( reader . getSeed () == 777 ) ;
+  CHECK ( reader . getMode () == PieceGenerator :: MODE_BAG ) ;
+
+  GameEngine replayed ;
+  CHECK ( reader . replay ( replayed ) ) ;
+  CHECK ( replayed . getTick () == live . getTick () ) ;
+
+  GameState a = live . snapshot () , b = replayed . snapshot () ;
+  CHECK ( a . score == b . score ) ;
+  CHECK ( a . lines_cleared == b . lines_cleared ) ;
+  CHECK ( a . active == b . active && a . active . pos_x == b . active . pos_x
+       && a . active . pos_y == b . active . pos_y ) ;
+  CHECK ( a . generator . next () == b . generator . next () ) ;
+  for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
+    for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+      CHECK ( a . board . get ( x , y ) == b . board . get ( x , y ) ) ;
+
+  // the writer thread gets everything out by close, ending with the final tick
+  JournalWriter background ;
+  CHECK ( background . open ( filename , 778 , PieceGenerator :: MODE_RANDOM ) ) ;
+  for ( uint32_t tick = 0 ; tick < 3000 ; tick += 3 )
+  {
+    background . record ( tick , inputs [ tick % n_inputs ] ) ;
+  }
+  background . flush () ;
+  CHECK ( background . close ( 4000 ) ) ;
+  CHECK ( background . getLost () == 0 ) ;
+
+  JournalReader reread ;
+  CHECK ( reread . open ( filename ) ) ;
+  uint32_t tick = 0 ;
+  int event = 0 , n_read = 0 ;
+  while ( reread . next ( tick , event ) )
+    ++n_read ;
+  CHECK ( n_read == 1001 ) ;
+  CHECK ( tick == 4000 && event == EV_NONE ) ;
+  CHECK ( !reread . isLossy () ) ;
+
+  // recording far more than BBT_JOURNAL_BLOCKS blocks before the writer
+  // looks drops records, and the file says so
+  JournalWriter behind ;
+  CHECK ( behind . open ( filename , 779 , PieceGenerator :: MODE_RANDOM ) ) ;
+  for ( uint32_t tick = 0 ; tick < BBT_JOURNAL_BUFFER_SIZE * BBT_JOURNAL_BLOCKS * 4 ; ++tick )
+  {
+    behind . record ( tick , inputs [ tick % n_inputs ] ) ;
+  }
+  CHECK ( !behind . close ( BBT_JOURNAL_BUFFER_SIZE * BBT_JOURNAL_BLOCKS * 4 ) ) ;
+  CHECK ( behind . getLost () > 0 ) ;
+  CHECK ( !behind . hasWriteFailed () ) ;
+
+  JournalReader lossy ;
+  CHECK ( lossy . open ( filename ) ) ;
+  CHECK ( lossy . isLossy () ) ;
+  CHECK ( lossy . getSeed () == 779 ) ;
+  GameEngine lossy_replay ;
+  CHECK ( !lossy . replay ( lossy_replay ) ) ;
+
+  unlink ( filename ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// the reader only ever sees the latest published frame, and the writer never
+// hands out the buffer the reader is holding
+static void testTripleBuffer ()
+{
+  TripleBuffer < int > frames ;
+  CHECK ( !frames . update () ) ;
+
+  for ( int frame = 1 ; frame <= 3 ; ++frame )
+  {
+    frames . back () = frame ;
+    frames . publish () ;
+  }
+  CHECK ( frames . update () && frames . front () == 3 ) ;
+  CHECK ( !frames . update () && frames . front () == 3 ) ;
+
+  const int* held = &frames . front () ;
+  for ( int frame = 4 ; frame <= 6 ; ++frame )
+  {
+    CHECK ( &frames . back () != held ) ;
+    frames . back () = frame ;
+    frames . publish () ;
+    CHECK ( *held == 3 ) ;
+  }
+  CHECK ( frames . update () && frames . front () == 6 ) ;
+  CHECK ( frames . getVersion () == 2 ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// a view kept up to date from deltas, some of them merged over several ticks,
+// always shows the same board as the engine
+static void testDeltaStream ()
+{
+  static const int inputs [] = { EV_START_LEFT , EV_STOP_LEFT , EV_START_RIGHT
+                               , EV_STOP_RIGHT , EV_ROT_LEFT , EV_START_DOWN
+                               , EV_STOP_DOWN , EV_PAUSE } ;
+  GameEngine engine ( 11 ) ;
+  PieceGenerator script ;
+  script . seed ( 12 ) ;
+
+  BoardView view ;
+  view . reset ( engine . snapshot () ) ;
+  GameDelta delta ;
+  engine . takeDelta ( delta ) ;
+
+  int start [ 2 ] = { EV_PAUSE , EV_PAUSE } ;
+  engine . step ( start , 1 , 0 ) ;
+
+  int resyncs = 0 , mismatches = 0 ;
+  for ( int tick = 0 ; tick < 20000 ; ++tick )
+  {
+    if ( engine . snapshot () . game_over )
+      engine . step ( start , 2 , 0 ) ;
+
+    int event = inputs [ script . nextBelow ( 8 ) ] ;
+    engine . step ( &event , script . nextBelow ( 12 ) == 0 , 1 ) ;
+
+    // let changes pile up now and then, as when the display falls behind
+    if ( script . nextBelow ( 4 ) == 0 )
+      continue ;
+
+    engine . takeDelta ( delta ) ;
+    if ( !view . apply ( delta ) )
+    {
+      CHECK ( delta . resync ) ;
+      view . reset ( engine . snapshot () ) ;
+      ++resyncs ;
+    }
+
+    GameState state = engine . snapshot () ;
+    state . active . place ( state . board ) ;
+    for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
+      for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+        mismatches += !( view . getShown () . get ( x , y ) == state . board . get ( x , y ) ) ;
+    mismatches += view . getStatus () . score != state . score ;
+    mismatches += view . getStatus () . paused != state . paused ;
+    mismatches += view . getStatus () . next != state . next ;
+  }
+  CHECK ( mismatches == 0 ) ;
+  CHECK ( resyncs > 0 ) ;
+
+  // a delta that is not newer than the view is ignored
+  CHECK ( !view . apply ( delta ) ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// the view shows the same board as the engine, counting the active piece
+static int countMismatches ( const BoardView &view , const GameEngine &engine )
+{
+  GameState state = engine . snapshot () ;
+  state . active . place ( state . board ) ;
+  int mismatches = 0 ;
+  for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
+    for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+      mismatches += !( view . getShown () . get ( x , y ) == state . board . get ( x , y ) ) ;
+  return mismatches ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// input applied between ticks, as the tickless controller does, publishes
+// several deltas with the same tick, and every one of them is shown
+static void testSameTickDeltas ()
+{
+  GameEngine engine ( 32 ) ;
+  BoardView view ;
+  view . reset ( engine . snapshot () ) ;
+
+  int start = EV_PAUSE ;
+  engine . step ( &start , 1 , 0 ) ;
+  engine . step ( NULL , 0 , 1 ) ;
+  GameDelta first , second ;
+  engine . takeDelta ( first ) ;
+  if ( !view . apply ( first ) )
+    view . reset ( engine . snapshot () ) ;
+
+  // the first piece of this seed looks different after each of these
+  static const int inputs [] = { EV_ROT_LEFT , EV_ROT_RIGHT , EV_ROT_RIGHT } ;
+  for ( unsigned int loop = 0 ; loop < 3 ; ++loop )
+  {
+    engine . step ( &inputs [ loop ] , 1 , 0 ) ;
+    engine . takeDelta ( second ) ;
+    CHECK ( second . tick == first . tick ) ;
+    CHECK ( second . seq > first . seq ) ;
+    CHECK ( view . apply ( second ) ) ;
+    CHECK ( view . getSeq () == second . seq ) ;
+    CHECK ( view . getTick () == first . tick ) ;
+    CHECK ( countMismatches ( view , engine ) == 0 ) ;
+  }
+
+  // a state copied at a resync covers the deltas taken before it
+  engine . step ( &inputs [ 0 ] , 1 , 0 ) ;
+  engine . takeDelta ( first ) ;
+  view . reset ( engine . snapshot () ) ;
+  CHECK ( view . getSeq () == first . seq ) ;
+  CHECK ( !view . apply ( first ) ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// nothing but the tick counter changes before the tick ticksUntilChange
+// predicts, and nothing at all while paused
+static void testTicksUntilChange ()
+{
+  static const int inputs [] = { EV_START_LEFT , EV_STOP_LEFT , EV_START_RIGHT
+                               , EV_STOP_RIGHT , EV_ROT_LEFT , EV_START_DOWN
+                               , EV_STOP_DOWN , EV_PAUSE } ;
+  GameEngine engine ( 21 ) ;
+  PieceGenerator script ;
+  script . seed ( 22 ) ;
+  GameDelta delta ;
+
+  CHECK ( engine . ticksUntilChange () == 0 ) ;
+  int start [ 2 ] = { EV_PAUSE , EV_PAUSE } ;
+  engine . step ( start , 1 , 0 ) ;
+
+  int early_changes = 0 , waits = 0 ;
+  for ( int loop = 0 ; loop < 3000 ; ++loop )
+  {
+    if ( engine . snapshot () . game_over )
+    {
+      CHECK ( engine . ticksUntilChange () == 0 ) ;
+      engine . step ( start , 2 , 0 ) ;
+    }
+    int event = inputs [ script . nextBelow ( 7 ) ] ;
+    engine . step ( &event , 1 , 0 ) ;
+
+    unsigned int ticks = engine . ticksUntilChange () ;
+    CHECK ( ticks > 0 ) ;
+    engine . takeDelta ( delta ) ;
+    Tetromino active = engine . snapshot () . active ;
+
+    for ( unsigned int tick = 1 ; tick < ticks ; ++tick )
+    {
+      engine . step ( NULL , 0 , 1 ) ;
+      engine . takeDelta ( delta ) ;
+      early_changes += delta . resync || delta . n_changes || !delta . active . samePose ( active ) ;
+      ++waits ;
+    }
+    engine . step ( NULL , 0 , 1 ) ;
+  }
+  CHECK ( early_changes == 0 ) ;
+  CHECK ( waits > 0 ) ;
+
+  engine . step ( start , 1 , 0 ) ;
+  CHECK ( engine . snapshot () . paused ) ;
+  CHECK ( engine . ticksUntilChange () == 0 ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// the shape of a cell by comparing it with each neighbour, as the display
+// used to
+static BlockShape expectedShape ( const BoardState &board , int x , int y )
+{
+  static const int offsets [ 8 ][ 2 ] = { { -1 , -1 } , { 0 , -1 } , { 1 , -1 } , { -1 , 0 }
+                                        , { 1 , 0 } , { -1 , 1 } , { 0 , 1 } , { 1 , 1 } } ;
+  const BlockData &block = board . get ( x , y ) ;
+  if ( block . color == 0 )
+    return 0 ;
+
+  BlockShape shape = block . color << SHAPE_COLOR_SHIFT ;
+  for ( int i = 0 ; i < 8 ; ++i )
+  {
+    int nx = x + offsets [ i ][ 0 ] , ny = y + offsets [ i ][ 1 ] ;
+    if ( nx >= 0 && nx < BOARD_WIDTH && ny >= 0 && ny < BOARD_HEIGHT && board . get ( nx , ny ) == block )
+      shape |= 1 << i ;
+  }
+  return shape ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// shapes updated only around changed cells match shapes worked out from
+// scratch, and exactly the cells whose shape differs are reported changed
+static void testShapeMap ()
+{
+  static const int inputs [] = { EV_START_LEFT , EV_STOP_LEFT , EV_START_RIGHT
+                               , EV_STOP_RIGHT , EV_ROT_LEFT , EV_ROT_RIGHT
+                               , EV_START_DOWN , EV_STOP_DOWN } ;
+  GameEngine engine ( 21 ) ;
+  PieceGenerator script ;
+  script . seed ( 22 ) ;
+
+  BoardView view ;
+  view . reset ( engine . snapshot () ) ;
+  GameDelta delta ;
+  engine . takeDelta ( delta ) ;
+
+  int start [ 2 ] = { EV_PAUSE , EV_PAUSE } ;
+  engine . step ( start , 1 , 0 ) ;
+
+  ShapeMap shapes ;
+  BlockShape last [ BOARD_HEIGHT ][ BOARD_WIDTH ] = {} ;
+  int wrong = 0 , wrong_changed = 0 , changed = 0 ;
+  for ( int tick = 0 ; tick < 5000 ; ++tick )
+  {
+    if ( engine . snapshot () . game_over )
+      engine . step ( start , 2 , 0 ) ;
+
+    int event = inputs [ script . nextBelow ( 8 ) ] ;
+    engine . step ( &event , script . nextBelow ( 4 ) == 0 , 1 ) ;
+
+    engine . takeDelta ( delta ) ;
+    if ( !view . apply ( delta ) )
+      view . reset ( engine . snapshot () ) ;
+
+    shapes . update ( view . getShown () , view . getRedrawRows () ) ;
+    view . clearRedraw () ;
+
+    for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+      for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
+      {
+        BlockShape expected = expectedShape ( view . getShown () , x , y ) ;
+        bool reported = ( shapes . getChanged ( y ) >> x ) & 1 ;
+        wrong += shapes . get ( x , y ) != expected ;
+        wrong_changed += reported != ( expected != last [ y ][ x ] ) ;
+        changed += reported ;
+        last [ y ][ x ] = expected ;
+      }
+    shapes . clearChanged () ;
+  }
+  CHECK ( wrong == 0 ) ;
+  CHECK ( wrong_changed == 0 ) ;
+  CHECK ( changed > 0 ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// a full ring drops instead of blocking, and held buttons are put right once
+// the consumer has caught up
+static void testEventRing ()
+{
+  EventRing ring ;
+  InputEvent out [ EventRing :: size + 8 ] ;
+
+  CHECK ( ring . push ( EV_START_LEFT , 1 ) ) ;
+  for ( uint32_t loop = 1 ; loop < EventRing :: size ; ++loop )
+    CHECK ( ring . push ( EV_ROT_LEFT , loop + 1 ) ) ;
+
+  // lost: a rotation, a left release and a full down press
+  CHECK ( !ring . push ( EV_ROT_RIGHT , 100 ) ) ;
+  CHECK ( !ring . push ( EV_STOP_LEFT , 101 ) ) ;
+  CHECK ( !ring . push ( EV_START_DOWN , 102 ) ) ;
+  CHECK ( !ring . push ( EV_STOP_DOWN , 103 ) ) ;
+  CHECK ( !ring . push ( EV_START_RIGHT , 104 ) ) ;
+  CHECK ( ring . getDropped () == 5 ) ;
+
+  // nothing is made up until everything queued before the drop is out
+  CHECK ( ring . drain ( out , 10 ) == 10 ) ;
+  CHECK ( out [ 0 ] . event == EV_START_LEFT && out [ 0 ] . time_ns == 1 ) ;
+  unsigned int n_events = ring . drain ( out , EventRing :: size + 8 ) ;
+  CHECK ( n_events == EventRing :: size - 10 + 2 ) ;
+  CHECK ( out [ n_events - 2 ] . event == EV_STOP_LEFT && out [ n_events - 2 ] . time_ns == 0 ) ;
+  CHECK ( out [ n_events - 1 ] . event == EV_START_RIGHT ) ;
+
+  CHECK ( ring . drain ( out , EventRing :: size ) == 0 ) ;
+  CHECK ( ring . push ( EV_PAUSE , 200 ) ) ;
+  CHECK ( ring . drain ( out , EventRing :: size ) == 1 && out [ 0 ] . event == EV_PAUSE ) ;
+
+  // once enabled, the eventfd counts pushes until read
+  int fd = ring . enableNotify () ;
+  CHECK ( fd >= 0 ) ;
+  CHECK ( ring . enableNotify () == fd ) ;
+  uint64_t count = 0 ;
+  CHECK ( read ( fd , &count , sizeof ( count ) ) < 0 ) ;
+  CHECK ( ring . push ( EV_ROT_LEFT , 300 ) ) ;
+  CHECK ( ring . push ( EV_ROT_RIGHT , 301 ) ) ;
+  CHECK ( read ( fd , &count , sizeof ( count ) ) == sizeof ( count ) && count == 2 ) ;
+  CHECK ( ring . drain ( out , EventRing :: size ) == 2 ) ;
+}
+
+struct RingProducer
+{
+  EventRing* ring ;
+  int id ;
+  uint32_t pushed ;
+} ;
+
+static void* produceEvents ( void* in_producer )
+{
+  RingProducer* producer = ( RingProducer* ) in_producer ;
+  for ( uint32_t loop = 1 ; loop <= 200000 ; ++loop )
+  {
+    if ( producer -> ring -> push ( EV_ROT_LEFT + producer -> id , loop ) )
+      ++producer -> pushed ;
+  }
+  return NULL ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// with several producers nothing is duplicated or reordered per producer, and
+// every event is either delivered or counted as dropped
+static void testEventRingThreads ()
+{
+  EventRing ring ;
+  RingProducer producers [ 2 ] ;
+  pthread_t threads [ 2 ] ;
+  for ( int loop = 0 ; loop < 2 ; ++loop )
+  {
+    producers [ loop ] . ring = &ring ;
+    producers [ loop ] . id = loop ;
+    producers [ loop ] . pushed = 0 ;
+    pthread_create ( &threads [ loop ] , NULL , produceEvents , &producers [ loop ] ) ;
+  }
+
+  uint64_t last [ 2 ] = { 0 , 0 } ;
+  uint32_t received [ 2 ] = { 0 , 0 } ;
+  int out_of_order = 0 ;
+  while ( received [ 0 ] + received [ 1 ] + ring . getDropped () < 400000 )
+  {
+    InputEvent out [ 16 ] ;
+    unsigned int n_events = ring . drain ( out , 16 ) ;
+    for ( unsigned int loop = 0 ; loop < n_events ; ++loop )
+    {
+      int id = out [ loop ] . event - EV_ROT_LEFT ;
+      out_of_order += out [ loop ] . time_ns <= last [ id ] ;
+      last [ id ] = out [ loop ] . time_ns ;
+      ++received [ id ] ;
+    }
+  }
+
+  for ( int loop = 0 ; loop < 2 ; ++loop )
+  {
+    pthread_join ( threads [ loop ] , NULL ) ;
+    CHECK ( received [ loop ] == producers [ loop ] . pushed ) ;
+  }
+  CHECK ( out_of_order == 0 ) ;
+  CHECK ( received [ 0 ] + received [ 1 ] + ring . getDropped () == 400000 ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// percentiles land in the right bucket and are never below the true value
+static void testHistogram ()
+{
+  Histogram histogram ;
+  CHECK ( histogram . percentile ( 0.5 ) == 0 ) ;
+
+  for ( uint64_t value = 1 ; value <= 100000 ; ++value )
+    histogram . record ( value * 1000 ) ;
+  CHECK ( histogram . count () == 100000 ) ;
+
+  static const double ps [] = { 0.01 , 0.5 , 0.9 , 0.99 , 1.0 } ;
+  for ( int loop = 0 ; loop < 5 ; ++loop )
+  {
+    double exact = ps [ loop ] * 100000 * 1000 ;
+    double reported = histogram . percentile ( ps [ loop ] ) ;
+    CHECK ( reported >= exact && reported <= exact * 1.07 ) ;
+  }
+
+  histogram . record ( 0 ) ;
+  histogram . record ( ~0ULL ) ;
+  CHECK ( histogram . percentile ( 0.0 ) == 0 ) ;
+  CHECK ( histogram . percentile ( 1.0 ) == ~0ULL ) ;
+
+  // Written out, the buckets add up to every value recorded
+  char buffer [ 65536 ] ;
+  FILE* out = fmemopen ( buffer , sizeof ( buffer ) , "w" ) ;
+  histogram . write ( out , "h" ) ;
+  fclose ( out ) ;
+
+  unsigned long long written = 0 , bound , n ;
+  int used ;
+  for ( const char* line = buffer ; sscanf ( line , "h %llu %llu\n%n" , &bound , &n , &used ) == 2 ; line += used )
+    written += n ;
+  CHECK ( written == histogram . count () ) ;
+
+  histogram . reset () ;
+  CHECK ( histogram . count () == 0 ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// deadlines stay exactly a period apart, wait never returns before one, and
+// a caller busy for several periods is told how many it skipped
+static void testTickTimer ( TickTimer &timer )
+{
+  const uint64_t period = 5000000 ;
+  CHECK ( timer . start ( period ) ) ;
+  uint64_t deadline = timer . getDeadline () ;
+
+  for ( int loop = 0 ; loop < 4 ; ++loop )
+  {
+    unsigned long skipped = timer . wait () ;
+    CHECK ( timer . getDeadline () == deadline + ( 1 + skipped ) * period ) ;
+    CHECK ( monotonicNs () >= timer . getDeadline () ) ;
+    deadline = timer . getDeadline () ;
+  }
+
+  // a period and a half after the next deadline
+  timespec busy = { 0 , ( long ) ( period * 5 / 2 ) } ;
+  nanosleep ( &busy , NULL ) ;
+  unsigned long skipped = timer . wait () ;
+  CHECK ( skipped >= 1 ) ;
+  CHECK ( timer . getDeadline () == deadline + ( 1 + skipped ) * period ) ;
+  CHECK ( monotonicNs () >= timer . getDeadline () ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// sessions only get the input pushed to them, directly or from the sources
+// bound to them, and the ones playing keep up with the clock while the
+// others stay paused
+static void testSessionHost ()
+{
+  SessionHost host ( 2 ) ;
+  for ( int loop = 0 ; loop < 8 ; ++loop )
+    CHECK ( host . addSession ( 100 + loop ) == ( unsigned int ) loop ) ;
+  CHECK ( host . getSessionCount () == 8 && host . getThreadCount () == 2 ) ;
+
+  // source 50 + n plays session n
+  for ( unsigned int loop = 4 ; loop < 8 ; loop += 2 )
+    CHECK ( host . bindSource ( 50 + loop , loop ) ) ;
+  CHECK ( !host . bindSource ( 58 , 8 ) ) ;
+
+  // before start as well as after
+  CHECK ( host . push ( 0 , EV_PAUSE , monotonicNs () ) ) ;
+  CHECK ( host . push ( 0 , EV_START_DOWN , monotonicNs () ) ) ;
+  CHECK ( host . start () ) ;
+  CHECK ( !host . bindSource ( 51 , 1 ) ) ;
+  CHECK ( host . push ( 2 , EV_PAUSE , monotonicNs () ) ) ;
+  CHECK ( host . push ( 2 , EV_START_DOWN , monotonicNs () ) ) ;
+  for ( unsigned int loop = 4 ; loop < 8 ; loop += 2 )
+  {
+    CHECK ( host . pushFrom ( 50 + loop , EV_PAUSE , monotonicNs () ) ) ;
+    CHECK ( host . pushFrom ( 50 + loop , EV_START_DOWN , monotonicNs () ) ) ;
+  }
+  CHECK ( !host . push ( 8 , EV_PAUSE , monotonicNs () ) ) ;
+  CHECK ( !host . pushFrom ( 51 , EV_PAUSE , monotonicNs () ) ) ;
+
+  timespec play = { 0 , 300000000 } ;
+  nanosleep ( &play , NULL ) ;
+  host . stop () ;
+
+  for ( unsigned int loop = 0 ; loop < 8 ; ++loop )
+  {
+    SessionStatus status = host . getStatus ( loop ) ;
+    CHECK ( status . paused == ( loop % 2 == 1 ) ) ;
+    CHECK ( !status . game_over ) ;
+    // held down, playing sessions wake up every other tick
+    if ( loop % 2 == 0 )
+      CHECK ( status . tick >= 10 ) ;
+  }
+  CHECK ( host . getInputLatency () . count () == 8 ) ;
+  CHECK ( host . getTickLateness () . count () > 0 ) ;
+
+  // stopped, so nothing more runs
+  uint64_t wakeups = host . getWakeups () ;
+  CHECK ( wakeups > 0 ) ;
+  nanosleep ( &play , NULL ) ;
+  CHECK ( host . getWakeups () == wakeups ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// report raw engine speed, not a pass/fail check
+static void reportSpeed ()
+{
+  GameEngine engine ;
+  int events [ 3 ] = { EV_PAUSE , EV_PAUSE , EV_START_LEFT } ;
+  engine . step ( &events [ 1 ] , 2 , 0 ) ;
+
+  const unsigned int ticks = 1000000 ;
+  timespec start , end ;
+  clock_gettime ( CLOCK_MONOTONIC , &start ) ;
+
+  for ( unsigned int loop = 0 ; loop < ticks ; ++loop )
+  {
+    if ( engine . snapshot () . game_over )
+      engine . step ( events , 3 , 0 ) ;
+    engine . step ( NULL , 0 , 1 ) ;
+  }
+
+  clock_gettime ( CLOCK_MONOTONIC , &end ) ;
+  double secs = ( end . tv_sec - start . tv_sec ) + ( end . tv_nsec - start . tv_nsec ) * 1e-9 ;
+  printf ( "engine: %u ticks in %.3f s (%.0f ticks/s)\n" , ticks , secs , ticks / secs ) ;
+}
+
+int main ( int argc , char** argv )
+{
+  testBoardMasks () ;
+  testRemoveRows () ;
+  testPieceShapes () ;
+  testPauseAndDrop () ;
+  testGameOver () ;
+  testSeeding () ;
+  testJournalReplay () ;
+  testTripleBuffer () ;
+  testDeltaStream () ;
+  testSameTickDeltas () ;
+  testTicksUntilChange () ;
+  testShapeMap () ;
+  testEventRing () ;
+  testEventRingThreads () ;
+  testHistogram () ;
+
+  NanosleepTimer nanosleep_timer ;
+  testTickTimer ( nanosleep_timer ) ;
+  TimerfdTimer timerfd_timer ;
+  testTickTimer ( timerfd_timer ) ;
+  testSessionHost () ;
+
+  reportSpeed () ;
+
+  printf ( "engine_test: %d failures\n" , failures ) ;
+  return failures ? 1 : 0 ;
+}
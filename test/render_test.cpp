@@ -0,0 +1,519 @@
+///////////////////////////////////////////////////////////////////////////////
+// \file test that drawing from the texture atlas in one batch, with blocks
+// looked up from their ShapeMap shapes, gives exactly what the old immediate
+// mode code drew with one texture per image and neighbour compares. Both are
+// rendered into an offscreen EGL pbuffer, which Mesa's software rasterizer
+// provides without a display, and compared pixel by pixel. The same frame
+// from the SoftBackend has to come within a couple of levels of the GL one,
+// and the atlas saved to a bundle and mapped again has to draw it exactly.
+// Returns non-zero if any check fails; skips with a message if no GL context
+// can be created.
+
+#include "BlockTextureMap.hpp"
+#include "BoardState.hpp"
+#include "BBTdefines.hpp"
+#include "QuadBatch.hpp"
+#include "ShapeMap.hpp"
+#include "SoftBackend.hpp"
+#include "TextureAtlas.hpp"
+
+#include <EGL/egl.h>
+#include <GL/gl.h>
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+typedef EGLDisplay ( *GetPlatformDisplay ) ( EGLenum , void* , const EGLint* ) ;
+
+static const int SCREEN_WIDTH = 272 ;
+static const int SCREEN_HEIGHT = 480 ;
+static const GLdouble BOARD_INSET = ( AREA_WIDTH - BOARD_WIDTH ) / 2.0 ;
+
+// Largest difference in any channel between the software and GL frames,
+// from rounding the bilinear weights differently
+static const int SOFT_TOLERANCE = 2 ;
+
+static int failures = 0 ;
+
+// Separate textures for the reference drawing, by atlas ID
+static std :: vector < GLuint > textures ;
+static AtlasId tex_message ;
+
+#define CHECK(cond) \
+  do { \
+    if ( !( cond ) ) \
+    { \
+      printf ( "%s:%d: check failed: %s\n" , __FILE__ , __LINE__ , #cond ) ; \
+      ++failures ; \
+    } \
+  } while ( 0 )
+
+///////////////////////////////////////////////////////////////////////////////
+// The drawing code the batch replaced, kept as the reference
+static void drawBox ( GLfloat x , GLfloat y , GLfloat w , GLfloat h )
+{
+  glBegin ( GL_QUADS ) ;
+  glTexCoord2f ( 0.0f , 1.0f ) ;
+  glVertex2f ( x , y ) ;
+  glTexCoord2f ( 0.0f , 0.0f ) ;
+  glVertex2f ( x , y + h ) ;
+  glTexCoord2f ( 1.0f , 0.0f ) ;
+  glVertex2f ( x + w , y + h ) ;
+  glTexCoord2f ( 1.0f , 1.0f ) ;
+  glVertex2f ( x + w , y ) ;
+  glEnd () ;
+}
+
+static void drawBox ( GLfloat x , GLfloat y , GLfloat w , GLfloat h , AtlasId tex )
+{
+  glEnable ( GL_TEXTURE_2D ) ;
+  glBindTexture ( GL_TEXTURE_2D , textures [ tex ] ) ;
+  glColor3ub ( 255 , 255 , 255 ) ;
+  drawBox ( x , y , w , h ) ;
+  glDisable ( GL_TEXTURE_2D ) ;
+}
+
+static void drawBlockPart ( float x , float y , float w , float h , AtlasId tex )
+{
+  glBindTexture ( GL_TEXTURE_2D , textures [ tex ] ) ;
+
+  glPushMatrix () ;
+  glTranslatef ( x , y , 0.0f ) ;
+
+  glBegin ( GL_QUADS ) ;
+  glTexCoord2f ( x , 1.0f - y ) ;
+  glVertex2f ( 0.0f , 0.0f ) ;
+  glTexCoord2f ( x , 1.0f - y - h ) ;
+  glVertex2f ( 0.0f , h ) ;
+  glTexCoord2f ( x + w , 1.0f - y - h ) ;
+  glVertex2f ( w , h ) ;
+  glTexCoord2f ( x + w , 1.0f - y ) ;
+  glVertex2f ( w , 0.0f ) ;
+  glEnd () ;
+
+  glPopMatrix () ;
+}
+
+static void drawBlock ( float x , float y , const BlockTextureMap &map )
+{
+  glPushMatrix () ;
+  glTranslatef ( x , y , 0.0f ) ;
+
+  glColor3ub ( ( map . color >> 16 ) & 0xFF , ( map . color >> 8 ) & 0xFF , map . color & 0xFF ) ;
+
+  if ( map . color == 0 )
+  {
+    drawBox ( 0.0f , 0.0f , 1.0f , 1.0f ) ;
+  }
+  else
+  {
+    glEnable ( GL_TEXTURE_2D ) ;
+    drawBlockPart ( 0.00f , 0.75f , 0.25f , 0.25f , map . tex [ 0 ][ 2 ] ) ;
+    drawBlockPart ( 0.25f , 0.75f , 0.50f , 0.25f , map . tex [ 1 ][ 2 ] ) ;
+    drawBlockPart ( 0.75f , 0.75f , 0.25f , 0.25f , map . tex [ 2 ][ 2 ] ) ;
+    drawBlockPart ( 0.00f , 0.25f , 0.25f , 0.50f , map . tex [ 0 ][ 1 ] ) ;
+    drawBlockPart ( 0.25f , 0.25f , 0.50f , 0.50f , map . tex [ 1 ][ 1 ] ) ;
+    drawBlockPart ( 0.75f , 0.25f , 0.25f , 0.50f , map . tex [ 2 ][ 1 ] ) ;
+    drawBlockPart ( 0.00f , 0.00f , 0.25f , 0.25f , map . tex [ 0 ][ 0 ] ) ;
+    drawBlockPart ( 0.25f , 0.00f , 0.50f , 0.25f , map . tex [ 1 ][ 0 ] ) ;
+    drawBlockPart ( 0.75f , 0.00f , 0.25f , 0.25f , map . tex [ 2 ][ 0 ] ) ;
+    glDisable ( GL_TEXTURE_2D ) ;
+  }
+
+  glPopMatrix () ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Offscreen context the size of the BeagleBone LCD
+static bool createContext ()
+{
+  GetPlatformDisplay getPlatformDisplay =
+    ( GetPlatformDisplay ) eglGetProcAddress ( "eglGetPlatformDisplayEXT" ) ;
+
+  EGLDisplay display = EGL_NO_DISPLAY ;
+  if ( getPlatformDisplay )
+    display = getPlatformDisplay ( EGL_PLATFORM_SURFACELESS_MESA , EGL_DEFAULT_DISPLAY , NULL ) ;
+  if ( display == EGL_NO_DISPLAY )
+    display = eglGetDisplay ( EGL_DEFAULT_DISPLAY ) ;
+
+  EGLint major , minor ;
+  if ( display == EGL_NO_DISPLAY || !eglInitialize ( display , &major , &minor ) )
+    return false ;
+
+  if ( !eglBindAPI ( EGL_OPENGL_API ) )
+    return false ;
+
+  static const EGLint config_attribs [] = { EGL_SURFACE_TYPE , EGL_PBUFFER_BIT
+                                          , EGL_RENDERABLE_TYPE , EGL_OPENGL_BIT
+                                          , EGL_RED_SIZE , 8 , EGL_GREEN_SIZE , 8
+                                          , EGL_BLUE_SIZE , 8 , EGL_NONE } ;
+  EGLConfig config ;
+  EGLint n_configs = 0 ;
+  if ( !eglChooseConfig ( display , config_attribs , &config , 1 , &n_configs ) || n_configs == 0 )
+    return false ;
+
+  static const EGLint surface_attribs [] = { EGL_WIDTH , SCREEN_WIDTH
+                                           , EGL_HEIGHT , SCREEN_HEIGHT , EGL_NONE } ;
+  EGLSurface surface = eglCreatePbufferSurface ( display , config , surface_attribs ) ;
+  EGLContext context = eglCreateContext ( display , config , EGL_NO_CONTEXT , NULL ) ;
+  if ( surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT )
+    return false ;
+
+  return eglMakeCurrent ( display , surface , surface , context ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// An image with a different gradient per id, so a part sampling the wrong
+// region or the wrong image shows up in the comparison. It goes both into
+// the atlas and into a texture of its own, as the display used to load it.
+// The atlas border acts like GL_CLAMP_TO_EDGE, so the reference clamps too:
+// with the default GL_REPEAT the scaled down next piece would pick up half a
+// texel from the opposite edge of each image.
+static AtlasId makeImage ( TextureAtlas &atlas , int id , int width , int height )
+{
+  std :: vector < uint8_t > pixels ( width * height * 4 ) ;
+  for ( int y = 0 ; y < height ; ++y )
+    for ( int x = 0 ; x < width ; ++x )
+    {
+      uint8_t* pixel = &pixels [ ( y * width + x ) * 4 ] ;
+      pixel [ 0 ] = 255 - x * 255 / width ;
+      pixel [ 1 ] = 255 - y * 255 / height ;
+      pixel [ 2 ] = 64 + ( ( x * id + y * 3 ) & 0x7F ) ;
+      pixel [ 3 ] = 255 ;
+    }
+
+  GLuint tex ;
+  glGenTextures ( 1 , &tex ) ;
+  glBindTexture ( GL_TEXTURE_2D , tex ) ;
+  glTexImage2D ( GL_TEXTURE_2D , 0 , GL_RGBA , width , height , 0 , GL_RGBA , GL_UNSIGNED_BYTE , &pixels [ 0 ] ) ;
+  glTexParameteri ( GL_TEXTURE_2D , GL_TEXTURE_MIN_FILTER , GL_LINEAR ) ;
+  glTexParameteri ( GL_TEXTURE_2D , GL_TEXTURE_MAG_FILTER , GL_LINEAR ) ;
+  glTexParameteri ( GL_TEXTURE_2D , GL_TEXTURE_WRAP_S , GL_CLAMP_TO_EDGE ) ;
+  glTexParameteri ( GL_TEXTURE_2D , GL_TEXTURE_WRAP_T , GL_CLAMP_TO_EDGE ) ;
+
+  char name [ 16 ] ;
+  snprintf ( name , sizeof ( name ) , "image%d" , id ) ;
+  AtlasId image = atlas . add ( &pixels [ 0 ] , width , height , width * 4 , name ) ;
+  textures . resize ( image + 1 ) ;
+  textures [ image ] = tex ;
+  return image ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Images land inside the atlas without overlapping, each with a border
+// copied from its edges
+static void testAtlasPacking ( const TextureAtlas &atlas )
+{
+  CHECK ( atlas . getWidth () >= 202 && atlas . getHeight () >= 402 ) ;
+
+  for ( AtlasId a = 0 ; a < textures . size () ; ++a )
+  {
+    const AtlasRegion &ra = atlas . getRegion ( a ) ;
+    int x0 = ra . u0 * atlas . getWidth () + 0.5f , y0 = ra . v0 * atlas . getHeight () + 0.5f ;
+    int x1 = ra . u1 * atlas . getWidth () + 0.5f , y1 = ra . v1 * atlas . getHeight () + 0.5f ;
+    CHECK ( x0 >= 1 && y0 >= 1 && x1 < atlas . getWidth () && y1 < atlas . getHeight () ) ;
+
+    // The border pixels match the edge pixels next to them
+    const uint8_t* pixels = atlas . getPixels () ;
+    int stride = atlas . getWidth () * 4 ;
+    CHECK ( !memcmp ( pixels + ( y0 - 1 ) * stride + ( x0 - 1 ) * 4 , pixels + y0 * stride + x0 * 4 , 4 ) ) ;
+    CHECK ( !memcmp ( pixels + y1 * stride + x1 * 4 , pixels + ( y1 - 1 ) * stride + ( x1 - 1 ) * 4 , 4 ) ) ;
+
+    for ( AtlasId b = 0 ; b < a ; ++b )
+    {
+      const AtlasRegion &rb = atlas . getRegion ( b ) ;
+      CHECK ( ra . u1 <= rb . u0 || rb . u1 <= ra . u0 || ra . v1 <= rb . v0 || rb . v1 <= ra . v0 ) ;
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Every block shape has a sprite, shared by the neighbour combinations that
+// look the same, and the old constructors find it too
+static void testSprites ( const TextureAtlas &atlas )
+{
+  std :: vector < AtlasId > sprites ;
+  for ( BlockShape neighbours = 0 ; neighbours <= SHAPE_NEIGHBOURS ; ++neighbours )
+  {
+    BlockTextureMap map ( ( BlockShape ) ( neighbours | 1 << SHAPE_COLOR_SHIFT ) ) ;
+    CHECK ( map . sprite >= textures . size () ) ;
+    CHECK ( atlas . getImageWidth ( map . sprite ) == 20 && atlas . getImageHeight ( map . sprite ) == 20 ) ;
+    if ( std :: find ( sprites . begin () , sprites . end () , map . sprite ) == sprites . end () )
+      sprites . push_back ( map . sprite ) ;
+  }
+
+  // The 47 tiles of a blob tileset
+  CHECK ( sprites . size () == 47 ) ;
+
+  BoardState board ;
+  board . set ( 0 , 0 , BlockData ( 1 , 2 ) ) ;
+  board . set ( 1 , 0 , BlockData ( 1 , 2 ) ) ;
+  CHECK ( BlockTextureMap ( 0 , 0 , board ) . sprite == BlockTextureMap ( ( BlockShape ) SHAPE_RIGHT ) . sprite ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// A board of irregular pieces, so every neighbour case comes up
+static void fillBoard ( BoardState &board , uint32_t seed )
+{
+  uint8_t next_id = 1 ;
+  for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+    for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
+    {
+      seed = seed * 1103515245 + 12345 ;
+      int choice = ( seed >> 16 ) % 8 ;
+
+      if ( choice < 2 )
+        continue ;
+      else if ( choice < 4 && x > 0 )
+        board . set ( x , y , board . get ( x - 1 , y ) ) ;
+      else if ( choice < 6 && y > 0 )
+        board . set ( x , y , board . get ( x , y - 1 ) ) ;
+      else
+      {
+        board . set ( x , y , BlockData ( next_id , next_id % 7 + 1 ) ) ;
+        next_id = next_id % 250 + 1 ;
+      }
+    }
+}
+
+static void readScreen ( std :: vector < uint8_t > &pixels )
+{
+  pixels . resize ( SCREEN_WIDTH * SCREEN_HEIGHT * 4 ) ;
+  glFinish () ;
+  glReadPixels ( 0 , 0 , SCREEN_WIDTH , SCREEN_HEIGHT , GL_RGBA , GL_UNSIGNED_BYTE , &pixels [ 0 ] ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The board from its shapes, as the display draws it, with a message and a
+// scaled copy of the board's corner where the next piece goes
+static void drawScene ( RenderBackend &backend , const BoardState &board )
+{
+  ShapeMap shapes ;
+  shapes . updateAll ( board ) ;
+
+  for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+    for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
+      backend . addBlock ( BOARD_INSET + x , y , 1.0f , BlockTextureMap ( shapes . get ( x , y ) ) ) ;
+  backend . addBox ( tex_message , BOARD_INSET + 2.0f , 4.0f , 1.0f , 2.0f ) ;
+
+  backend . addBox ( TextureAtlas :: WHITE , 10.0f , AREA_HEIGHT - 3.5f , 3.0f , 3.0f , 0x000000 ) ;
+  for ( int y = 0 ; y < 2 ; ++y )
+    for ( int x = 0 ; x < 4 ; ++x )
+      backend . addBlock ( 11.5f + ( x - 1.5f ) * 0.75f , AREA_HEIGHT - 2.0f + ( y - 1.0f ) * 0.75f
+                         , 0.75f , BlockTextureMap ( x , y , board ) ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Draw the board, a scaled copy of its corner where the next piece goes and a
+// message, first with the old code and then batched, and compare the results
+static void compareBoard ( QuadBatch &batch , const BoardState &board )
+{
+  std :: vector < uint8_t > expected , actual ;
+
+  // Reference
+  glClear ( GL_COLOR_BUFFER_BIT ) ;
+
+  glPushMatrix () ;
+  glTranslatef ( BOARD_INSET , 0.0f , 0.0f ) ;
+  for ( int y = 0 ; y < BOARD_HEIGHT ; ++y )
+    for ( int x = 0 ; x < BOARD_WIDTH ; ++x )
+      drawBlock ( x , y , BlockTextureMap ( x , y , board ) ) ;
+  drawBox ( 2.0f , 4.0f , 1.0f , 2.0f , tex_message ) ;
+  glPopMatrix () ;
+
+  glPushMatrix () ;
+  glTranslatef ( 11.5f , AREA_HEIGHT - 2.0f , 0.0f ) ;
+  glColor3ub ( 0 , 0 , 0 ) ;
+  drawBox ( -1.5f , -1.5f , 3.0f , 3.0f ) ;
+  glScalef ( 0.75f , 0.75f , 0.0f ) ;
+  for ( int y = 0 ; y < 2 ; ++y )
+    for ( int x = 0 ; x < 4 ; ++x )
+      drawBlock ( x - 1.5f , y - 1.0f , BlockTextureMap ( x , y , board ) ) ;
+  glPopMatrix () ;
+
+  readScreen ( expected ) ;
+
+  // Batched, from the atlas
+  glClear ( GL_COLOR_BUFFER_BIT ) ;
+  drawScene ( batch , board ) ;
+  batch . flush () ;
+
+  readScreen ( actual ) ;
+
+  int lit = 0 , different = 0 ;
+  for ( size_t i = 0 ; i < expected . size () ; i += 4 )
+  {
+    if ( expected [ i ] || expected [ i + 1 ] || expected [ i + 2 ] )
+      ++lit ;
+    if ( expected [ i ] != actual [ i ] || expected [ i + 1 ] != actual [ i + 1 ]
+         || expected [ i + 2 ] != actual [ i + 2 ] )
+      ++different ;
+  }
+
+  CHECK ( lit > SCREEN_WIDTH * SCREEN_HEIGHT / 4 ) ;
+  CHECK ( different == 0 ) ;
+  if ( different )
+    printf ( "render_test: %d of %d pixels differ\n" , different , SCREEN_WIDTH * SCREEN_HEIGHT ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The same frame drawn on the CPU, compared with GL's, and only the area
+// drawn since the last flush flushed again
+static void compareSoft ( QuadBatch &batch , SoftBackend &soft , const BoardState &board )
+{
+  std :: vector < uint8_t > expected ;
+
+  glClear ( GL_COLOR_BUFFER_BIT ) ;
+  drawScene ( batch , board ) ;
+  batch . flush () ;
+  readScreen ( expected ) ;
+
+  drawScene ( soft , board ) ;
+  CHECK ( !soft . empty () ) ;
+  uint64_t flushed = soft . getFlushedPixels () ;
+  soft . flush () ;
+  CHECK ( soft . empty () ) ;
+
+  // Both count every quad, whether or not it lands on screen
+  CHECK ( soft . getLastFlush () . quads == batch . getLastFlush () . quads ) ;
+  CHECK ( batch . getLastFlush () . quads >= BOARD_WIDTH * BOARD_HEIGHT + 2 ) ;
+  CHECK ( batch . getLastFlush () . calls > 0 ) ;
+
+  // The board and the next piece's box, give or take where rectangles merged
+  uint64_t drawn = BOARD_WIDTH * BOARD_HEIGHT * 20 * 20 + 60 * 60 ;
+  CHECK ( soft . getFlushedPixels () - flushed <= drawn * 11 / 10 ) ;
+
+  // GL rows are from the bottom
+  const uint32_t* actual = soft . getPixels () ;
+  int different = 0 , worst = 0 ;
+  for ( int y = 0 ; y < SCREEN_HEIGHT ; ++y )
+    for ( int x = 0 ; x < SCREEN_WIDTH ; ++x )
+    {
+      const uint8_t* gl = &expected [ ( ( SCREEN_HEIGHT - 1 - y ) * SCREEN_WIDTH + x ) * 4 ] ;
+      uint32_t pixel = actual [ y * SCREEN_WIDTH + x ] ;
+      int diff = std :: max ( std :: max ( abs ( gl [ 0 ] - ( int ) ( pixel >> 16 & 0xFF ) )
+                                         , abs ( gl [ 1 ] - ( int ) ( pixel >> 8 & 0xFF ) ) )
+                            , abs ( gl [ 2 ] - ( int ) ( pixel & 0xFF ) ) ) ;
+      worst = std :: max ( worst , diff ) ;
+      if ( diff > SOFT_TOLERANCE )
+        ++different ;
+    }
+
+  CHECK ( different == 0 ) ;
+  if ( different )
+    printf ( "render_test: %d pixels of the software frame differ, by up to %d\n" , different , worst ) ;
+
+  // Nothing drawn, nothing to flush
+  flushed = soft . getFlushedPixels () ;
+  soft . flush () ;
+  CHECK ( soft . getFlushedPixels () == flushed ) ;
+  CHECK ( soft . getLastFlush () . quads == 0 && soft . getLastFlush () . calls == 0 ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// A saved bundle maps back to the same atlas, images, names and sprites, and
+// draws the same frame. A cut short bundle is turned down.
+static void testBundle ( const TextureAtlas &atlas , SoftBackend &soft , const BoardState &board )
+{
+  char file [] = "/tmp/render_test_XXXXXX" ;
+  int fd = mkstemp ( file ) ;
+  CHECK ( fd >= 0 ) ;
+  if ( fd < 0 )
+    return ;
+  close ( fd ) ;
+
+  CHECK ( atlas . save ( file ) ) ;
+  BlockTextureMap sprite_map ( ( BlockShape ) ( SHAPE_LEFT | SHAPE_UP | 1 << SHAPE_COLOR_SHIFT ) ) ;
+
+  TextureAtlas mapped ;
+  CHECK ( mapped . map ( file ) ) ;
+  CHECK ( mapped . getWidth () == atlas . getWidth () && mapped . getHeight () == atlas . getHeight () ) ;
+  CHECK ( !memcmp ( mapped . getPixels () , atlas . getPixels () , atlas . getWidth () * atlas . getHeight () * 4 ) ) ;
+  CHECK ( mapped . find ( "image8" ) == tex_message ) ;
+  CHECK ( mapped . find ( "image9" ) == TextureAtlas :: NOT_FOUND ) ;
+
+  for ( AtlasId id = 0 ; id < textures . size () ; ++id )
+  {
+    const AtlasRegion &a = atlas . getRegion ( id ) , &b = mapped . getRegion ( id ) ;
+    CHECK ( a . u0 == b . u0 && a . v0 == b . v0 && a . u1 == b . u1 && a . v1 == b . v1 ) ;
+  }
+
+  CHECK ( BlockTextureMap :: findSprites ( mapped ) ) ;
+  CHECK ( BlockTextureMap ( ( BlockShape ) ( SHAPE_LEFT | SHAPE_UP | 1 << SHAPE_COLOR_SHIFT ) ) == sprite_map ) ;
+
+  SoftBackend from_bundle ;
+  CHECK ( from_bundle . open () && from_bundle . load ( mapped ) ) ;
+  drawScene ( soft , board ) ;
+  drawScene ( from_bundle , board ) ;
+  CHECK ( !memcmp ( soft . getPixels () , from_bundle . getPixels () , SCREEN_WIDTH * SCREEN_HEIGHT * 4 ) ) ;
+
+  // Truncated: not mapped, and what was there stays
+  CHECK ( truncate ( file , atlas . getWidth () * atlas . getHeight () * 2 ) == 0 ) ;
+  CHECK ( !mapped . map ( file ) ) ;
+  CHECK ( mapped . find ( "image8" ) == tex_message ) ;
+
+  unlink ( file ) ;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main ( int argc , char** argv )
+{
+  if ( !createContext () )
+  {
+    printf ( "render_test: no offscreen GL context, skipped\n" ) ;
+    return 0 ;
+  }
+  printf ( "render_test: %s\n" , glGetString ( GL_RENDERER ) ) ;
+
+  glViewport ( 0 , 0 , SCREEN_WIDTH , SCREEN_HEIGHT ) ;
+  glMatrixMode ( GL_PROJECTION ) ;
+  glLoadIdentity () ;
+  glOrtho ( 0.0 , AREA_WIDTH , 0.0 , AREA_HEIGHT , -1.0 , 1.0 ) ;
+  glMatrixMode ( GL_MODELVIEW ) ;
+  glLoadIdentity () ;
+  glDisable ( GL_DEPTH_TEST ) ;
+  glClearColor ( 0.0f , 0.0f , 0.0f , 0.0f ) ;
+
+  TextureAtlas atlas ;
+  textures . push_back ( 0 ) ; // TextureAtlas :: WHITE is never drawn textured by the old code
+  block_textures . bg = makeImage ( atlas , 1 , 20 , 20 ) ;
+  block_textures . outer = makeImage ( atlas , 2 , 20 , 20 ) ;
+  block_textures . inner = makeImage ( atlas , 3 , 20 , 20 ) ;
+  block_textures . top = makeImage ( atlas , 4 , 20 , 20 ) ;
+  block_textures . bottom = makeImage ( atlas , 5 , 20 , 20 ) ;
+  block_textures . left = makeImage ( atlas , 6 , 20 , 20 ) ;
+  block_textures . right = makeImage ( atlas , 7 , 20 , 20 ) ;
+  tex_message = makeImage ( atlas , 8 , 200 , 400 ) ;
+
+  BlockTextureMap :: buildSprites ( atlas ) ;
+  testSprites ( atlas ) ;
+
+  QuadBatch batch ;
+  SoftBackend soft ;
+  CHECK ( batch . load ( atlas ) ) ;
+  CHECK ( soft . open () && soft . load ( atlas ) ) ;
+  testAtlasPacking ( atlas ) ;
+
+  for ( uint32_t seed = 1 ; seed <= 4 ; ++seed )
+  {
+    BoardState board ;
+    fillBoard ( board , seed ) ;
+    compareBoard ( batch , board ) ;
+    compareSoft ( batch , soft , board ) ;
+  }
+
+  BoardState board ;
+  fillBoard ( board , 5 ) ;
+  testBundle ( atlas , soft , board ) ;
+
+  printf ( "render_test: %d failures\n" , failures ) ;
+  return failures ? 1 : 0 ;
+}